@@ -27,6 +27,7 @@ int PTC::Main(void)
     
     //-------------------------------------------------------------
     // Run Tests
+    // (the checkpoint journal is kept if this throws, so a restart resumes)
     try
     {
         this->Run_Tests();
@@ -36,6 +37,8 @@ int PTC::Main(void)
         return ERROR_RUN;
     }
     
+    this->EndJournal();
+    
     //-------------------------------------------------------------
     // Engineering testing area
     try
@@ -121,6 +124,24 @@ int PTC::Run_Tests(void)
     
     // Tests normally run here (removed)
     
+    // Each step can be checkpointed, so a PTC restarted after a crash skips
+    // the steps already done on the same parts.  Once the parts are powered
+    // and talking, ResumeJournal reads which steps are done, e.g.
+    //
+    //      this->ResumeJournal();
+    //
+    //      if ( !this->Completed(STEP_TRIM) ||
+    //          !this->Restore(STEP_TRIM, status, &trim[0][0], NUM_TRIM, &snap) )
+    //      {
+    //          // ... run the step, fill status and trim ...
+    //          this->ASIC->GetSnapshot(&snap, this->listDut);
+    //          this->Checkpoint(STEP_TRIM, status, &trim[0][0], NUM_TRIM, &snap);
+    //      }
+    //
+    // with STEP_TRIM numbered in PTCSpecific.h in the order the steps run.
+    // A step whose record can't be read back (like a snapshot from another
+    // build) is run again.
+    
     return SUCCESS;
 }
     
@@ -137,6 +158,7 @@ int PTC::Currently_Testing(void)
     this->Tool->PowerOnPart(OPERATING_VOLTAGE, this->listDut);
     this->Tool->ConnectComm(COM_I2C, this->listDut);
     this->ASIC->SetSlaveAddr(PTCInfo.Spec.slave_addr, listDut);
+    this->ASIC->SetState(STATE_DEVICE_UNKNOWN, this->listDut);   // new parts
     //-------------------------------------------------------------
     
     //TESTING always display
@@ -20,9 +20,6 @@ private:
     CBF(void);
     
     void SetupRegisterMap(void);
-    void SetupPage0(void);
-    void SetupPage1(void);
-    void SetupPage2(void);
 
 public:
     ~CBF(void);
@@ -0,0 +1,214 @@
+/******************************************************************************
+
+    File:   BFregisters.h
+    Desc:   Register map of the BF ASIC as a constant table.  Shift and
+            bitcount are calculated by the compiler, and the RAM map is checked
+            at compile time, so a mis-specified register fails the build.
+
+******************************************************************************/
+#ifndef _BF_REGISTERS_H_
+#define _BF_REGISTERS_H_
+
+#include "RegisterTypeDefs.h"
+
+/******************************************************************************
+* Register list format: include all useful registers                          *
+* REG(member, name, page, addr, mask, conversion, memory, number, RAMvalue)   *
+* RAMvalue = YES for registers that belong in RAMregisters (all RAM values    *
+* must be accounted for or the build fails)                                   *
+******************************************************************************/
+#define BF_REGISTERS(REG) \
+    /* Page 0: outputs */ \
+    REG(REG_ACCEL_OUT_X,    "ACCEL_OUT_X",  PAGE_00, 0x18, 0xFF, sense_output, Volatile, NUM_ACCEL_OUT, NO) \
+    REG(REG_ACCEL_OUT_Y,    "ACCEL_OUT_Y",  PAGE_00, 0x1A, 0xFF, sense_output, Volatile, NUM_ACCEL_OUT, NO) \
+    REG(REG_ACCEL_OUT_Z,    "ACCEL_OUT_Z",  PAGE_00, 0x1C, 0xFF, sense_output, Volatile, NUM_ACCEL_OUT, NO) \
+    /* Page 0: response (cotr) */ \
+    REG(REG_RESP,           "RESP",         PAGE_00, 0x20, 0xFF, convert_byte, Volatile, 1, NO) \
+    /* Page 0: settings */ \
+    REG(REG_CNTL1,          "CNTL1",        PAGE_00, 0x2A, 0xFF, convert_byte, Volatile, 1, NO) \
+    REG(REG_CNTL2,          "CNTL2",        PAGE_00, 0x2B, 0xFF, convert_byte, Volatile, 1, NO) \
+    REG(REG_INC1,           "INC1",         PAGE_00, 0x30, 0xFF, convert_byte, Volatile, 1, NO) \
+    REG(REG_INC4,           "INC4",         PAGE_00, 0x33, 0xFF, convert_byte, Volatile, 1, NO) \
+    REG(REG_TSC,            "TSC",          PAGE_00, 0x37, 0xFF, convert_byte, Volatile, 1, NO) \
+    REG(REG_EXTRA_MIRROR,   "EXTRA_MIRROR", PAGE_00, 0x43, 0xFF, convert_byte, Volatile, 1, NO) \
+    /* Page 0: selftest (mask is the key) */ \
+    REG(REG_SELFTEST,       "SELFTEST",     PAGE_00, 0x5D, 0x88, convert_uint, Volatile, 1, NO) \
+    /* Page 0: buffer (BUF_CNTL2 bit4 is reserved) */ \
+    REG(REG_BUF_CNTL1,      "BUF_CNTL1",    PAGE_00, 0x6A, 0xFF, convert_byte, Volatile, 1, NO) \
+    REG(REG_BUF_CNTL2,      "BUF_CNTL2",    PAGE_00, 0x6B, 0xEF, convert_byte, Volatile, 1, NO) \
+    REG(REG_BUF_STATUS1,    "BUF_STATUS1",  PAGE_00, 0x6C, 0xFF, convert_byte, Volatile, 1, NO) \
+    /* Page 0: OTP control (OTPAC bits 2-5 reserved, MUXC bit7 tm_steps_wr) */ \
+    REG(REG_MR,             "MR",           PAGE_00, 0x73, 0xFF, convert_byte, Volatile, 1, NO) \
+    REG(REG_OTPAC,          "OTPAC",        PAGE_00, 0x74, 0xC3, convert_byte, Volatile, 1, NO) \
+    REG(REG_MUXC,           "MUXC",         PAGE_00, 0x75, 0x0F, convert_byte, Volatile, 1, NO) \
+    REG(REG_BIST_CNTL,      "BIST_CNTL",    PAGE_00, 0x76, 0xFF, convert_byte, Volatile, 1, NO) \
+    REG(REG_TM_DTB,         "TM_DTB",       PAGE_00, 0x7D, 0xFF, convert_byte, Volatile, 1, NO) \
+    REG(REG_AMEM2,          "AMEM2",        PAGE_00, 0x72, 0xFF, convert_byte, Volatile, 1, NO) \
+    REG(REG_AMEM1,          "AMEM1",        PAGE_00, 0x7E, 0xFF, convert_byte, Volatile, 1, NO) \
+    /* Page 0: only setup mempage on page 0 */ \
+    REG(REG_MEMPAGE,        "MEMPAGE",      PAGE_00, 0x7F, 0x03, convert_byte, Volatile, 1, NO) \
+    /* Page 0: special registers (bits of CNTL1 and CNTL2) */ \
+    REG(REG_PC1,            "PC1",          PAGE_00, 0x2A, 0x80, convert_bit,  Volatile, 1, NO) \
+    REG(REG_RES,            "RES",          PAGE_00, 0x2A, 0x40, convert_bit,  Volatile, 1, NO) \
+    REG(REG_SRST,           "SRST",         PAGE_00, 0x2B, 0x80, convert_byte, Volatile, 1, NO) \
+    REG(REG_COTC,           "COTC",         PAGE_00, 0x2B, 0x40, convert_bit,  Volatile, 1, NO) \
+    /* Page 0: all Volatile registers */ \
+    REG(RawVOLATILE,        "RawVOLATILE",  PAGE_00, 0x00, 0xFF, convert_byte, Volatile, NUM_VOL_REG, NO) \
+    \
+    /* Page 1: RAM */ \
+    REG(REG_OSC,            "OSC",          PAGE_01, 0x19, 0x3F, convert_uint, RAM, 1, YES) \
+    REG(REG_SPARE_1,        "SPARE1",       PAGE_01, 0x1A, 0xFF, convert_byte, RAM, 1, YES) \
+    REG(REG_WDT,            "WDT",          PAGE_01, 0x1B, 0xFF, convert_uint, RAM, 1, YES) \
+    REG(REG_ACCEL_STX,      "ACCEL_STX",    PAGE_01, 0x1C, 0x0F, convert_uint, RAM, 1, YES) \
+    REG(REG_ACCEL_STY,      "ACCEL_STY",    PAGE_01, 0x1C, 0xF0, convert_uint, RAM, 1, YES) \
+    REG(REG_ACCEL_STZ,      "ACCEL_STZ",    PAGE_01, 0x1D, 0x0F, convert_uint, RAM, 1, YES) \
+    REG(REG_WAI,            "WAI",          PAGE_01, 0x1E, 0xFF, convert_byte, RAM, 1, YES) \
+    /* Page 1: extra contains part_en, hs, sad1, ssb, stnf, ppod, and tcen */ \
+    REG(REG_EXTRA,          "EXTRA",        PAGE_01, 0x1F, 0xFE, convert_byte, RAM, 1, YES) \
+    REG(REG_BGT,            "BGT",          PAGE_01, 0x20, 0x7F, convert_uint, RAM, 1, YES) \
+    REG(REG_BGCH,           "BGCH",         PAGE_01, 0x20, 0x80, convert_bit,  RAM, 1, YES) \
+    REG(REG_ACCEL_TCX,      "ACCEL_TCX",    PAGE_01, 0x21, 0xFF, convert_uint, RAM, 1, YES) \
+    REG(REG_ACCEL_TCY,      "ACCEL_TCY",    PAGE_01, 0x22, 0xFF, convert_uint, RAM, 1, YES) \
+    REG(REG_ACCEL_TCZ,      "ACCEL_TCZ",    PAGE_01, 0x23, 0xFF, convert_uint, RAM, 1, YES) \
+    REG(REG_LL,             "LL",           PAGE_01, 0x28, 0xFF, convert_uint, RAM, 1, YES) \
+    REG(REG_HL,             "HL",           PAGE_01, 0x29, 0xFF, convert_uint, RAM, 1, YES) \
+    REG(REG_TPGC,           "TPGC",         PAGE_01, 0x2A, 0x3F, convert_byte, RAM, 1, YES) \
+    REG(REG_LP_CNTL,        "LP_CNTL",      PAGE_01, 0x2B, 0xFF, convert_byte, RAM, 1, YES) \
+    REG(REG_ACCEL_CNTL,     "ACCEL_CNTL",   PAGE_01, 0x2C, 0xF3, convert_byte, RAM, 1, YES) \
+    REG(REG_XCAL,           "XCAL",         PAGE_01, 0x2D, 0xFF, convert_uint, RAM, 1, YES) \
+    REG(REG_YCAL,           "YCAL",         PAGE_01, 0x2E, 0xFF, convert_uint, RAM, 1, YES) \
+    REG(REG_ZCAL,           "ZCAL",         PAGE_01, 0x2F, 0xFF, convert_uint, RAM, 1, YES) \
+    REG(REG_ACCEL_ODR,      "ACCEL_ODR",    PAGE_01, 0x2F, 0x0F, convert_uint, RAM, 1, NO) \
+    REG(REG_REV_1,          "REV_1",        PAGE_01, 0x30, 0xFF, convert_byte, RAM, 1, YES) \
+    REG(REG_REV_2,          "REV_2",        PAGE_01, 0x31, 0xFF, convert_byte, RAM, 1, YES) \
+    REG(REG_WUFTH,          "WUFTH",        PAGE_01, 0x32, 0xFF, convert_byte, RAM, 1, YES) \
+    REG(REG_BTSTH_WUFTH,    "BTSTH_WUFTH",  PAGE_01, 0x33, 0x77, convert_byte, RAM, 1, YES) \
+    REG(REG_BTSTH,          "BTSTH",        PAGE_01, 0x34, 0xFF, convert_byte, RAM, 1, YES) \
+    REG(REG_BTSC,           "BTSC",         PAGE_01, 0x35, 0xFF, convert_byte, RAM, 1, YES) \
+    REG(REG_WUFC,           "WUFC",         PAGE_01, 0x36, 0xFF, convert_byte, RAM, 1, YES) \
+    REG(REG_SPARE_2,        "SPARE_2",      PAGE_01, 0x37, 0xFF, convert_byte, RAM, 1, NO) \
+    REG(REG_SPARE_3,        "SPARE_3",      PAGE_01, 0x38, 0xFF, convert_byte, RAM, 1, YES) \
+    REG(REG_SPARE_4,        "SPARE_4",      PAGE_01, 0x39, 0xFF, convert_byte, RAM, 1, YES) \
+    REG(REG_SPARE_5,        "SPARE_5",      PAGE_01, 0x3A, 0xFF, convert_byte, RAM, 1, YES) \
+    REG(REG_SPARE_6,        "SPARE_6",      PAGE_01, 0x3B, 0xFF, convert_byte, RAM, 1, YES) \
+    REG(REG_SPARE_7,        "SPARE_7",      PAGE_01, 0x3C, 0xFF, convert_byte, RAM, 1, YES) \
+    REG(REG_SPARE_8,        "SPARE_8",      PAGE_01, 0x3D, 0xFF, convert_byte, RAM, 1, YES) \
+    REG(REG_SPARE_9,        "SPARE_9",      PAGE_01, 0x3E, 0xFF, convert_byte, RAM, 1, YES) \
+    REG(REG_SPARE_10,       "SPARE_10",     PAGE_01, 0x3F, 0xFF, convert_byte, RAM, 1, YES) \
+    /* Page 1: special registers (bits of EXTRA and ACCEL_CNTL) */ \
+    REG(REG_SAD1,           "SAD1",         PAGE_01, 0x1F, 0x20, convert_byte, RAM, 1, YES) \
+    REG(REG_ACCEL_SWAP,     "ACCEL_SWAP",   PAGE_01, 0x2C, 0x03, convert_byte, RAM, 1, NO) \
+    /* Page 1: all RAM registers */ \
+    REG(RawRAM,             "RawRAM",       PAGE_01, 0x00, 0xFF, convert_byte, RAM, NUM_RAM_REG, NO) \
+    \
+    /* Page 2: all ROM registers */ \
+    REG(RawROM,             "RawROM",       PAGE_02, 0x00, 0xFF, convert_byte, ROM, NUM_ROM_REG, NO)
+
+/******************************************************************************
+* Multiple address register list format:                                     *
+* ARR(member, name, page, addr0..addr5, mask0..mask5, conversion, memory,     *
+*     number, lsb, msb, RAMvalue)                                             *
+******************************************************************************/
+#define BF_ARRAY_REGISTERS(ARR) \
+    /* Page 1: serial number (last byte is SPARE_2) */ \
+    ARR(REG_SN,     "SN_RAM",   PAGE_01, 0x14, 0x15, 0x16, 0x17, 0x37, ADDR_INVALID, \
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, convert_SN, RAM, MAX_SN_SIZE, ADDR_INVALID, ADDR_INVALID, YES) \
+    /* Page 1: special test register for development: must be read/write */ \
+    /* and 2 bytes (for the BF, using the ACCEL_FOX bytes) */ \
+    ARR(REG_TEST,   "TEST",     PAGE_01, 0x03, 0x06, ADDR_INVALID, ADDR_INVALID, ADDR_INVALID, ADDR_INVALID, \
+        0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, convert_uint, RAM, 2, 0, 1, NO) \
+    /* Page 2: serial number in ROM */ \
+    ARR(REG_SN_ROM, "SN_ROM",   PAGE_02, 0x10, 0x11, 0x12, 0x13, 0x24, ADDR_INVALID, \
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, convert_SN, ROM, MAX_SN_SIZE, ADDR_INVALID, ADDR_INVALID, NO)
+
+//-----------------------------------------------------------------------------
+//  register index into BFregisterMap
+#define BF_ENUM(member, ...)        BF_##member,
+
+enum BFregister {
+    BF_REGISTERS(BF_ENUM)
+    BF_ARRAY_REGISTERS(BF_ENUM)
+    BF_NUM_REGISTERS
+};
+
+//-----------------------------------------------------------------------------
+//  constant register table (built by the compiler, no startup calculations)
+#define BF_DEF(member, name, page, addr, mask, conv, mem, num, ramval) \
+    REGISTER_DEF(name, page, addr, mask, conv, mem, num),
+#define BF_ARRAY_DEF(member, name, page, a0, a1, a2, a3, a4, a5, \
+        m0, m1, m2, m3, m4, m5, conv, mem, num, lsb, msb, ramval) \
+    REGISTER_DEF_ARRAY(name, page, a0, a1, a2, a3, a4, a5, \
+        m0, m1, m2, m3, m4, m5, conv, mem, num, lsb, msb),
+
+static const RegisterDef BFregisterMap[BF_NUM_REGISTERS] = {
+    BF_REGISTERS(BF_DEF)
+    BF_ARRAY_REGISTERS(BF_ARRAY_DEF)
+};
+
+//-----------------------------------------------------------------------------
+//  compile-time checks for each register
+#define BF_CHECK(member, name, page, addr, mask, conv, mem, num, ramval) \
+    STATIC_CHECK((page) < NUM_PAGES, member##_page_is_invalid); \
+    STATIC_CHECK((addr) + (num) <= MAX_PAGE_SIZE, member##_does_not_fit_in_page); \
+    STATIC_CHECK(!(ramval) || (((page) == RAM_PG) && ((mem) == RAM)), member##_is_not_a_RAM_register);
+#define BF_ARRAY_CHECK(member, name, page, a0, a1, a2, a3, a4, a5, \
+        m0, m1, m2, m3, m4, m5, conv, mem, num, lsb, msb, ramval) \
+    STATIC_CHECK((page) < NUM_PAGES, member##_page_is_invalid); \
+    STATIC_CHECK(((num) > 0) && ((num) <= APP_MAX_ADDR), member##_has_too_many_addresses); \
+    STATIC_CHECK(!(ramval) || (((page) == RAM_PG) && ((mem) == RAM)), member##_is_not_a_RAM_register);
+
+BF_REGISTERS(BF_CHECK)
+BF_ARRAY_REGISTERS(BF_ARRAY_CHECK)
+
+//-----------------------------------------------------------------------------
+//  compile-time check of the RAM map: every RAM byte and value accounted for
+//  (same totals RAMstruct::Check verifies at runtime)
+#define BF_COVERS(member, name, page, addr, mask, conv, mem, num, ramval) \
+    || ((ramval) && (ADDR >= (addr)) && (ADDR < (addr) + (num)))
+#define BF_ARRAY_COVERS(member, name, page, a0, a1, a2, a3, a4, a5, \
+        m0, m1, m2, m3, m4, m5, conv, mem, num, lsb, msb, ramval) \
+    || ((ramval) && ( ((ADDR == (a0)) && (0 < (num))) || ((ADDR == (a1)) && (1 < (num))) || \
+                      ((ADDR == (a2)) && (2 < (num))) || ((ADDR == (a3)) && (3 < (num))) || \
+                      ((ADDR == (a4)) && (4 < (num))) || ((ADDR == (a5)) && (5 < (num))) ))
+
+#define BF_VALUE(member, name, page, addr, mask, conv, mem, num, ramval) \
+    + ((ramval) ? 1 : 0)
+#define BF_ARRAY_VALUE(member, name, page, a0, a1, a2, a3, a4, a5, \
+        m0, m1, m2, m3, m4, m5, conv, mem, num, lsb, msb, ramval) \
+    + ((ramval) ? 1 : 0)
+
+// 1 if any RAM value uses the byte at ADDR
+template <int ADDR>
+struct BFramCovers
+{
+    enum { value = (0 BF_REGISTERS(BF_COVERS) BF_ARRAY_REGISTERS(BF_ARRAY_COVERS)) ? 1 : 0 };
+};
+
+// number of RAM bytes used in addresses [0, N)
+template <int N>
+struct BFramBytes
+{
+    enum { value = BFramCovers<N - 1>::value + BFramBytes<N - 1>::value };
+};
+template <>
+struct BFramBytes<0> { enum { value = 0 }; };
+
+enum {
+    BF_NUM_RAM_VALUES = 0 BF_REGISTERS(BF_VALUE) BF_ARRAY_REGISTERS(BF_ARRAY_VALUE)
+};
+
+STATIC_CHECK(BFramBytes<MAX_PAGE_SIZE>::value == NUM_RAM_REG, BF_RAM_bytes_do_not_match_NUM_RAM_REG);
+STATIC_CHECK(BF_NUM_RAM_VALUES == NUM_RAM_VALUES, BF_RAM_values_do_not_match_NUM_RAM_VALUES);
+
+// the per-entry macros above are only for building this table
+#undef BF_ENUM
+#undef BF_DEF
+#undef BF_ARRAY_DEF
+#undef BF_CHECK
+#undef BF_ARRAY_CHECK
+#undef BF_COVERS
+#undef BF_ARRAY_COVERS
+#undef BF_VALUE
+#undef BF_ARRAY_VALUE
+
+#endif
@@ -27,6 +27,7 @@
 //-----------------------------------------------------------------------------
 // ASIC features
 #define _OTP_                               // One Time Programmable
+//#define _OTP_BURN_                        // OTP burn mode known (ProgramROM)
 //#define _EEPROM_                          // Re-programmable
 #define _HAS_PAGES_                         // has pages
 #define _HAS_SPARE_                         // has spare registers in RAM
@@ -64,15 +65,22 @@
 //#define NUM_TEMP_OUT        0             // temp comp registers
 
 #define BURN_VOLTAGE        3.3             // volts
+#define COTR_READY          0x55            // RESP (COTR) once reset is done
+#define SETTLE_SAMPLES      7               // samples for outputs to settle
+#define ACCEL_ODR_HZ(odr)   (((odr) < 8) ? (12.5 * (1 << (odr))) : (0.78125 * (1 << ((odr) - 8))))
+#ifdef _OTP_BURN_
+    #define BURN_RETRIES    2               // extra burns of weak OTP bits
+#endif
 #ifdef _NO_FLIP_
     #define NO_FLIP_VOLTAGE 0.0             // volts (if it has no-flip option)
 #endif
 
-// delay times (ms)
+// delay times (ms), the longest waits for the part to be ready
 #define DISABLE_DELAY       5               // after disabling
 #define CHANGE_STATE_DELAY  10              // after changing state
 #define ALTERNATE_DELAY     100             // after setting part to alternate    // TODO maybe later set this to 40, 100 might be too long
 #define RESET_DELAY         40              // after resetting the part
+#define TICK_DELAY          16              // GetTickCount resolution
 //#define BIAS_DELAY          0             // after enabling bias current
 #ifdef _OTP_
     #define MEMORY_DELAY    40              // after changing OTP memory access
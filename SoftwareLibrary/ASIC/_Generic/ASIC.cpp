@@ -108,11 +108,22 @@ void CASIC::SetState(int state, word* listDut)
     int origDBGVerify = DBGVerify;
     //DBGVerify = YES;
     
+    // read back every register set for this state at once
+    bool verify = (DBGVerify != 0);
+    if (verify)
+        this->BeginVerify();
+    
+    // CNTL1 when the part is enabled (full power)
+    int enable = this->REG_RES.mask[0] | this->REG_PC1.mask[0];
+    bool changed = false;
+    
     switch(state)
     {
         case STATE_DEVICE_UNKNOWN:
         {
             DBGTrace("STATE_DEVICE_UNKNOWN");
+            this->ForgetShadow(listDut);
+            this->ForgetMemoryAccess(listDut);
             this->CurrState = STATE_DEVICE_UNKNOWN;
             break;
         }
@@ -124,25 +135,11 @@ void CASIC::SetState(int state, word* listDut)
         {
             DBGTrace("STATE_DEVICE_ENABLE");
             
-            // disable self-test
-            this->SetRegister(this->REG_SELFTEST, (byte)0x00, listDut);
-            
-            // disable part (CNTL1)
-            this->SetRegister(this->REG_CNTL1, (byte)0x00, listDut);
-            
-            //TIMEDelay(DISABLE_DELAY);
+            // self-test off, cfg accel odr and self-test (INC1), enable part
+            StateTarget target = { 0x00, 0x02, 0x10, STATE_FIELD_ANY, enable };//TODO: generalize
+            changed = this->ChangeState(target, listDut);
             
-             // cfg accel odr
-            this->SetRegister(this->REG_ACCEL_ODR, (byte)0x02, listDut);//TODO: generalize
-            
-            // cfg self-test (INC1)
-            this->SetRegister(this->REG_INC1, (byte)0x10, listDut);//TODO: generalize
-            
-            // enable part (CNTL1)
-            this->SetRegister(this->REG_RES, HIGH, listDut);
-            this->SetRegister(this->REG_PC1, HIGH, listDut);
-            
-            //TIMEDelay(CHANGE_STATE_DELAY);
+            if (changed) this->SettleState(target, CHANGE_STATE_DELAY, listDut);
             this->CurrState = STATE_DEVICE_ENABLE;
             break;
         }
@@ -150,25 +147,12 @@ void CASIC::SetState(int state, word* listDut)
         {
             DBGTrace("STATE_DEVICE_DISABLE");
             
-            // disable self-test
-            this->SetRegister(this->REG_SELFTEST, (byte)0x00, listDut);
-            
-            // disable part (CNTL1)
-            this->SetRegister(this->REG_CNTL1, (byte)0x00, listDut);
+            // self-test off, cfg accel odr, self-test (INC1) and cmd-test
+            // (COTC), part disabled
+            StateTarget target = { 0x00, 0x02, 0x10, LOW, 0x00 };//TODO: generalize
+            changed = this->ChangeState(target, listDut);
             
-            //TIMEDelay(DISABLE_DELAY);
-            
-            // cfg accel odr
-            this->SetRegister(this->REG_ACCEL_ODR, (byte)0x02, listDut);//TODO: generalize
-            
-            // cfg self-test (INC1)
-            this->SetRegister(this->REG_INC1, (byte)0x10, listDut);//TODO: generalize
-            
-            // cfg cmd-test (COTC)
-            // the highest bit is already 0, since if it were one, the part would restart
-            this->SetRegister(this->REG_COTC, LOW, listDut);
-            
-            //TIMEDelay(DISABLE_DELAY);
+            // (ChangeState waits DISABLE_DELAY for the part to stop)
             this->CurrState = STATE_DEVICE_DISABLE;
             break;
         }
@@ -176,29 +160,12 @@ void CASIC::SetState(int state, word* listDut)
         {
             DBGTrace("STATE_RESPONSE_ENABLE");
             
-            // disable self-test
-            this->SetRegister(this->REG_SELFTEST, (byte)0x00, listDut);
-            
-            // disable part (CNTL1)
-            this->SetRegister(this->REG_CNTL1, (byte)0x00, listDut);
-            
-            //TIMEDelay(DISABLE_DELAY);
-            
-            // cfg accel odr
-            this->SetRegister(this->REG_ACCEL_ODR, (byte)0x02, listDut);//TODO: generalize
+            // self-test off, cfg accel odr and self-test (INC1), set COTC to 1
+            // (7th bit of CNTL2), enable part
+            StateTarget target = { 0x00, 0x02, 0x10, HIGH, enable };//TODO: generalize
+            changed = this->ChangeState(target, listDut);
             
-            // cfg self-test (INC1)
-            this->SetRegister(this->REG_INC1, (byte)0x10, listDut);//TODO: generalize
-            
-            // set COTC to 1 (7th bit) (CNTL2)
-            // the highest bit is already 0, since if it were one, the part would restart
-            this->SetRegister(this->REG_COTC, HIGH, listDut);
-            
-            // enable part (CNTL1)
-            this->SetRegister(this->REG_RES, HIGH, listDut);//TODO: generalize
-            this->SetRegister(this->REG_PC1, HIGH, listDut);//TODO: generalize
-            
-            //TIMEDelay(CHANGE_STATE_DELAY);
+            if (changed) this->SettleState(target, CHANGE_STATE_DELAY, listDut);
             this->CurrState = STATE_RESPONSE_ENABLE;
             break;
         }
@@ -206,28 +173,12 @@ void CASIC::SetState(int state, word* listDut)
         {
             DBGTrace("STATE_DEVICE_ALTERNATE");
             
-            // disable self-test
-            this->SetRegister(this->REG_SELFTEST, (byte)0x00, listDut);
-            
-            // disable part (CNTL1)
-            this->SetRegister(REG_CNTL1, (byte)0x00, listDut);
-            
-            //TIMEDelay(DISABLE_DELAY);
-            
-            // cfg accel odr
-            this->SetRegister(this->REG_ACCEL_ODR, (byte)0x02, listDut);//TODO: generalize
-            
-            // cfg self-test (INC1)
-            this->SetRegister(this->REG_INC1, (byte)0x10, listDut);//TODO: generalize
+            // self-test off, cfg accel odr, self-test (INC1) and cmd-test
+            // (COTC), enable part in low power (PC1 only)
+            StateTarget target = { 0x00, 0x02, 0x10, LOW, this->REG_PC1.mask[0] };//TODO: generalize
+            changed = this->ChangeState(target, listDut);
             
-            // cfg cmd-test (COTC)
-            this->SetRegister(this->REG_COTC, LOW, listDut);
-            // the highest bit is already 0, since if it were one, the part would restart
-            
-            // enable part (CNTL1)
-            this->SetRegister(this->REG_PC1, HIGH, listDut);
-            
-            //TIMEDelay(ALTERNATE_DELAY);
+            if (changed) this->SettleState(target, ALTERNATE_DELAY, listDut);
             this->CurrState = STATE_DEVICE_ALTERNATE;
             break;
         }
@@ -235,31 +186,12 @@ void CASIC::SetState(int state, word* listDut)
         {
             DBGTrace("STATE_SELFTEST_POS");
             
-            // disable self-test
-            this->SetRegister(this->REG_SELFTEST, (byte)0x00, listDut);
-            
-            // disable part (CNTL1)
-            this->SetRegister(this->REG_CNTL1, (byte)0x00, listDut);
-            
-            //TIMEDelay(DISABLE_DELAY);
-            
-             // cfg accel odr
-            this->SetRegister(this->REG_ACCEL_ODR, (byte)0x05, listDut);//TODO: generalize
-            
-            // cfg self-test (INC1)
-            this->SetRegister(this->REG_INC1, (byte)0x10, listDut);//TODO: generalize
-            
-            // cfg cmd-test (COTC)
-            this->SetRegister(this->REG_COTC, LOW, listDut);
+            // cfg accel odr, self-test (INC1) and cmd-test (COTC), enable
+            // part, then enable self-test
+            StateTarget target = { this->KEY_SELFTEST, 0x05, 0x10, LOW, enable };//TODO: generalize
+            changed = this->ChangeState(target, listDut);
             
-            // enable part (CNTL1)
-            this->SetRegister(this->REG_RES, HIGH, listDut);
-            this->SetRegister(this->REG_PC1, HIGH, listDut);
-            
-            // enable self-test
-            this->SetRegister(this->REG_SELFTEST, this->KEY_SELFTEST, listDut);
-            
-            //TIMEDelay(CHANGE_STATE_DELAY);
+            if (changed) this->SettleState(target, CHANGE_STATE_DELAY, listDut);
             this->CurrState = STATE_SELFTEST_POS;
             break;
         }
@@ -268,16 +200,8 @@ void CASIC::SetState(int state, word* listDut)
         {
             DBGTrace("STATE_SINGLE_ENDED_READ_MODE");
             
-            // set access memory key 1
-            this->SetRegister(this->REG_AMEM1, this->KEY_AMEM1, listDut);
-            
-            // set access memory key 2
-            this->SetRegister(this->REG_AMEM2, this->KEY_AMEM2, listDut);
-            
             // set mr register to single-ended
-            this->SetRegister(this->REG_MR, this->SINGLE_ENDED, listDut);
-            
-            //TIMEDelay(MEMORY_DELAY);
+            this->SetMemoryAccess(state, this->SINGLE_ENDED, listDut);
             
             this->CurrState = STATE_SINGLE_ENDED_READ_MODE;
             break;
@@ -286,16 +210,8 @@ void CASIC::SetState(int state, word* listDut)
         {
             DBGTrace("STATE_REDUNDANT_READ_MODE");
             
-            // set access memory key 1
-            this->SetRegister(this->REG_AMEM1, this->KEY_AMEM1, listDut);
-            
-            // set access memory key 2
-            this->SetRegister(this->REG_AMEM2, this->KEY_AMEM2, listDut);
-            
             // set mr register to differential-redundant
-            this->SetRegister(this->REG_MR, this->REDUNDANT, listDut);
-            
-            //TIMEDelay(MEMORY_DELAY);
+            this->SetMemoryAccess(state, this->REDUNDANT, listDut);
             
             this->CurrState = STATE_REDUNDANT_READ_MODE;
             break;
@@ -304,17 +220,25 @@ void CASIC::SetState(int state, word* listDut)
         {
             DBGTrace("STATE_LOCK_MEMORY_ACCESS");
             
-            // set access memory key 1
-            this->SetRegister(this->REG_AMEM1, 0x00, listDut);
+            // clear access memory keys (put off inside a memory access window)
+            if (this->MemDepth == 0)
+                this->SetMemoryAccess(state, 0x00, listDut);
             
-            // set access memory key 2
-            this->SetRegister(this->REG_AMEM2, 0x00, listDut);
+            this->CurrState = STATE_LOCK_MEMORY_ACCESS;
+            break;
+        }
+#ifdef _OTP_BURN_
+        case STATE_BURN_MODE:
+        {
+            DBGTrace("STATE_BURN_MODE");
             
-            //TIMEDelay(MEMORY_DELAY);
+            // set mr register to burn
+            this->SetMemoryAccess(state, this->BURN, listDut);
             
-            this->CurrState = STATE_LOCK_MEMORY_ACCESS;
+            this->CurrState = STATE_BURN_MODE;
             break;
         }
+#endif
 #endif
         default:
         {
@@ -326,9 +250,220 @@ void CASIC::SetState(int state, word* listDut)
         }
     }
     
+    if (verify)
+        this->EndVerify(listDut);
+    
     DBGVerify = origDBGVerify;
 }
 
+/******************************************************************************
+    Name:   SettleState
+    Desc:   Waits after a state change for a new accel sample on every site:
+            delay ms for the part to start, plus two sample periods at the
+            target ODR and one GetTickCount tick.  Without an accel there is
+            no output to watch, so it just waits delay ms.
+******************************************************************************/
+void CASIC::SettleState(const StateTarget& target, int delay, word* listDut)
+{
+    DBGTrace("--> CASIC::SettleState");
+    
+#ifdef _ACCEL_ENABLED_
+    int timeout = delay + TICK_DELAY;
+    
+    if (target.accel_odr != STATE_FIELD_ANY)
+        timeout += (int)ceil(2 * 1000.0 / ACCEL_ODR_HZ(target.accel_odr));
+    
+    // (warns about the sites that time out)
+    this->Accel->WaitForSamples(SENSE_ACCEL, 1, timeout, listDut);
+#else
+    Sleep(delay);
+#endif
+}
+
+/******************************************************************************
+    Name:   ChangeState
+    Desc:   Moves each site to target, writing only the registers that differ
+            from what was last written (see Changed):
+              - sites changing CNTL1 or the configuration (ACCEL_ODR, INC1,
+                COTC) have self-test and the part disabled first, and wait
+                DISABLE_DELAY for it to stop, since those can't change
+                while the part is running
+              - the configuration is written to the sites it changes on
+              - CNTL1 is set, with self-test disabled before it and enabled
+                after it
+            Returns true if anything was written (so the state delay is
+            needed).
+******************************************************************************/
+bool CASIC::ChangeState(const StateTarget& target, word* listDut)
+{
+    DBGTrace("--> CASIC::ChangeState");
+    
+    const ASICregister* config[3] = { &this->REG_ACCEL_ODR, &this->REG_INC1, &this->REG_COTC };
+    int value[3] = { target.accel_odr, target.inc1, target.cotc };
+    word change[3][TOOL_MAX_DUT + 1];
+    word siteDut[TOOL_MAX_DUT + 1];
+    word stopDut[TOOL_MAX_DUT + 1];
+    word sites = 0;
+    int num = 0;
+    int written = 0;
+    
+    // sites that have to be disabled to change
+    for (int f = 0; f < 3; f++)
+    {
+        change[f][0] = 0;
+        if (value[f] != STATE_FIELD_ANY)
+            this->Changed(*config[f], (byte)value[f], listDut, change[f]);
+        
+        for (int d = 0; change[f][d] != 0; d++)
+            sites |= (1 << (change[f][d] - 1));
+    }
+    
+    this->Changed(this->REG_CNTL1, (byte)target.cntl1, listDut, siteDut);
+    for (int d = 0; siteDut[d] != 0; d++)
+        sites |= (1 << (siteDut[d] - 1));
+    
+    for (int d = 0; listDut[d] != 0; d++)
+    {
+        if ((sites >> (listDut[d] - 1)) & 1)
+            siteDut[num++] = listDut[d];
+    }
+    siteDut[num] = 0;
+    
+    if (num > 0)
+    {
+        // disable self-test
+        if (this->Changed(this->REG_SELFTEST, 0x00, siteDut, stopDut) > 0)
+        {
+            this->SetRegister(this->REG_SELFTEST, (byte)0x00, stopDut);
+            written++;
+        }
+        
+        // disable part (CNTL1)
+        if (this->Changed(this->REG_CNTL1, 0x00, siteDut, stopDut) > 0)
+        {
+            this->SetRegister(this->REG_CNTL1, (byte)0x00, stopDut);
+            written++;
+            
+            // PC1 reads back 0 as soon as it is written, so there is
+            // nothing to poll: give the part its time to stop
+            Sleep(DISABLE_DELAY);
+        }
+        
+        // cfg accel odr, self-test (INC1), cmd-test (COTC)
+        for (int f = 0; f < 3; f++)
+        {
+            if (change[f][0] != 0)
+            {
+                this->SetRegister(*config[f], (byte)value[f], change[f]);
+                written++;
+            }
+        }
+    }
+    
+#ifdef _ACCEL_ENABLED_
+    // every site is at this ODR now (the band of the noise density)
+    if (target.accel_odr != STATE_FIELD_ANY)
+        this->Accel->SetCurrODR(ACCEL_ODR_HZ(target.accel_odr));
+#endif
+    
+    // disable self-test on the rest of the sites
+    if ( (target.selftest == 0x00) && (this->Changed(this->REG_SELFTEST, 0x00, listDut, stopDut) > 0) )
+    {
+        this->SetRegister(this->REG_SELFTEST, (byte)0x00, stopDut);
+        written++;
+    }
+    
+    // enable part (CNTL1)
+    if (this->Changed(this->REG_CNTL1, (byte)target.cntl1, listDut, siteDut) > 0)
+    {
+        this->SetRegister(this->REG_CNTL1, (byte)target.cntl1, siteDut);
+        written++;
+    }
+    
+    // enable self-test
+    if ( (target.selftest != 0x00) && (this->Changed(this->REG_SELFTEST, (byte)target.selftest, listDut, siteDut) > 0) )
+    {
+        this->SetRegister(this->REG_SELFTEST, (byte)target.selftest, siteDut);
+        written++;
+    }
+    
+    return (written > 0);
+}
+
+#ifdef _OTP_
+/******************************************************************************
+    Name:   SetMemoryAccess
+    Desc:   Changes the OTP memory access of each site to state, writing only
+            what differs from the mode the site is already in:
+              - sites already in state are skipped
+              - locked (or unknown) sites are sent the access memory keys
+              - every site changing read/burn mode has MR set to mode
+            Locking clears the keys instead.  The sites that change share one
+            MEMORY_DELAY, and inside a memory access window (see
+            BeginMemoryAccess) it is only paid by the first change.
+******************************************************************************/
+void CASIC::SetMemoryAccess(int state, byte mode, word* listDut)
+{
+    DBGTrace("--> CASIC::SetMemoryAccess");
+    
+    int dut;
+    int numKey = 0;
+    int numMode = 0;
+    word keyDut[TOOL_MAX_DUT + 1];
+    word modeDut[TOOL_MAX_DUT + 1];
+    bool lock = (state == STATE_LOCK_MEMORY_ACCESS);
+    
+    for (int d = 0; listDut[d] != 0; d++)
+    {
+        dut = listDut[d] - 1;
+        
+        if (this->MemAccess[dut] == state)
+            continue;
+        
+        if ( lock || (this->MemAccess[dut] == STATE_LOCK_MEMORY_ACCESS) ||
+            (this->MemAccess[dut] == STATE_DEVICE_UNKNOWN) )
+            keyDut[numKey++] = listDut[d];
+        
+        if (!lock)
+            modeDut[numMode++] = listDut[d];
+        
+        this->MemAccess[dut] = state;
+    }
+    keyDut[numKey] = 0;
+    modeDut[numMode] = 0;
+    
+    if ( (numKey == 0) && (numMode == 0) )
+        return;
+    
+    if (numKey > 0)
+    {
+        if (lock)
+        {
+            // clear access memory key 1 and 2
+            this->SetRegister(this->REG_AMEM1, 0x00, keyDut);
+            this->SetRegister(this->REG_AMEM2, 0x00, keyDut);
+        }
+        else
+        {
+            // set access memory key 1 and 2
+            this->SetRegister(this->REG_AMEM1, this->KEY_AMEM1, keyDut);
+            this->SetRegister(this->REG_AMEM2, this->KEY_AMEM2, keyDut);
+        }
+    }
+    
+    if (numMode > 0)
+        this->SetRegister(this->REG_MR, mode, modeDut);
+    
+    // nothing on the part shows the OTP access mode has settled, so wait
+    // (nothing reads the OTP once it is locked)
+    if ( !lock && !this->MemSettled )
+    {
+        Sleep(MEMORY_DELAY);
+        this->MemSettled = (this->MemDepth > 0);
+    }
+}
+#endif
+
 /******************************************************************************
     Name:   GetResponse
     Desc:   TODO fill in
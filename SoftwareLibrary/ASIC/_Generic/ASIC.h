@@ -11,6 +11,19 @@
 
 #include "DeviceCore.h"
 
+//-----------------------------------------------------------------------------
+//  StateTarget: what a device state sets its registers to (see SetState)
+#define STATE_FIELD_ANY     -1              // the state leaves it alone
+
+typedef struct StateTarget
+{
+    int selftest;                           // SELFTEST (key to enable)
+    int accel_odr;                          // ACCEL_ODR
+    int inc1;                               // INC1 (self-test cfg)
+    int cotc;                               // COTC (command test)
+    int cntl1;                              // CNTL1 (RES, PC1 to enable)
+} StateTarget;
+
 //-----------------------------------------------------------------------------
 //  ASIC class definition
 class CASIC : public CDeviceCore
@@ -24,6 +37,13 @@ protected:
     
     void SetDeviceTypes(void);
     void SetCommTypes(void);
+    
+    bool ChangeState(const StateTarget& target, word* listDut);
+    void SettleState(const StateTarget& target, int delay, word* listDut);
+    
+#ifdef _OTP_
+    void SetMemoryAccess(int state, byte mode, word* listDut);
+#endif
 
 public:
     ~CASIC(void);
@@ -47,8 +47,6 @@ void CAccel::SampleOutputs(int count, double* avg, double* st_dev, word* listDut
 {
     DBGTrace("---> CAccel::SampleOutputs");
     
-    // TODO: update this after testing
-    count = 1;
     int timeout = 0;
     
     // Passthrough to SenseBase
@@ -172,11 +170,15 @@ void CAccel::SetOffset(int* code, word* listDut)
     this->SetRegister(this->REG_ACCEL_FOY, &ycodes[0], listDut);
     this->SetRegister(this->REG_ACCEL_FOZ, &zcodes[0], listDut);
     
-    // TODO do this properly, once SetODR is implemented
-    this->CurrODR = 50;
+    if (this->CurrODR <= 0.0)
+    {
+        ERRChk(ERROR_RUN, "No ODR set to wait for the outputs to settle", "CAccel::SetOffset", false);
+        return;
+    }
     
-    int delay = (int)ceil(7000.0 / (double)this->CurrODR);
-    //TIMEDelay(delay);
+    // wait for the outputs to settle (up to twice the nominal time)
+    int delay = (int)ceil(SETTLE_SAMPLES * 1000.0 / (double)this->CurrODR);
+    this->WaitForSamples(SENSE_ACCEL, SETTLE_SAMPLES, 2 * delay, listDut);
 }
 
 /******************************************************************************
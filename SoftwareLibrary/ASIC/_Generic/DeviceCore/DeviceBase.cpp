@@ -23,6 +23,12 @@ CDeviceBase::CDeviceBase(void)
     CDeviceBase::SlaveAddr = NULL;
     CDeviceBase::CurrPage = PAGE_INVALID;
     
+    memset(this->Shadow, 0x00, sizeof(this->Shadow));
+    memset(this->Known, 0x00, sizeof(this->Known));
+    memset(this->NoVerify, 0x00, sizeof(this->NoVerify));
+    memset(this->NoRead, 0x00, sizeof(this->NoRead));
+    this->Written = NULL;
+    
 #ifdef _USE_FAKE_MEMORY_
     memset(FakeMemory, 0, sizeof(FakeMemory));
 #elif defined(_LV_COMM_)
@@ -36,6 +42,7 @@ CDeviceBase::CDeviceBase(void)
 ******************************************************************************/
 CDeviceBase::~CDeviceBase(void)
 {
+    delete this->Written;
 }
 
 /******************************************************************************
@@ -78,7 +85,7 @@ void CDeviceBase::SetPage(byte page, word* listDut, byte slave_addr)
     Name:   GetByte
     Desc:   Read from a single device register using Tool
 ******************************************************************************/
-void CDeviceBase::GetByte(byte page, byte reg_loc, byte* values, word* listDut, string label)
+void CDeviceBase::GetByte(byte page, byte reg_loc, byte* values, word* listDut, const char* label)
 {
     DBGTrace("---> CDeviceBase::GetByte");
     
@@ -89,7 +96,7 @@ void CDeviceBase::GetByte(byte page, byte reg_loc, byte* values, word* listDut,
     Name:   GetByte
     Desc:   Read from device registers using Tool
 ******************************************************************************/
-void CDeviceBase::GetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, string label)
+void CDeviceBase::GetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, const char* label)
 {
     DBGTrace("---> CDeviceBase::GetByte_array");
     
@@ -107,7 +114,7 @@ void CDeviceBase::GetByte(byte page, byte reg_loc, int count, byte* values, word
     Name:   SetByte
     Desc:   Write to device registers using Tool
 ******************************************************************************/
-void CDeviceBase::SetByte(byte page, byte reg_loc, byte value, word* listDut, string label)
+void CDeviceBase::SetByte(byte page, byte reg_loc, byte value, word* listDut, const char* label)
 {
     DBGTrace("---> CDeviceBase::SetByte");
     
@@ -121,7 +128,7 @@ void CDeviceBase::SetByte(byte page, byte reg_loc, byte value, word* listDut, st
     Name:   SetByte
     Desc:   Write to device registers using Tool
 ******************************************************************************/
-void CDeviceBase::SetByte(byte page, byte reg_loc, byte* values, word* listDut, string label)
+void CDeviceBase::SetByte(byte page, byte reg_loc, byte* values, word* listDut, const char* label)
 {
     DBGTrace("---> CDeviceBase::SetByte");
     
@@ -132,7 +139,7 @@ void CDeviceBase::SetByte(byte page, byte reg_loc, byte* values, word* listDut,
     Name:   SetByte
     Desc:   Write to device registers using Tool
 ******************************************************************************/
-void CDeviceBase::SetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, string label)
+void CDeviceBase::SetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, const char* label)
 {
     DBGTrace("---> CDeviceBase::SetByte_array");
     
@@ -144,6 +151,26 @@ void CDeviceBase::SetByte(byte page, byte reg_loc, int count, byte* values, word
     this->SetPage(page, listDut);
     Tool->Write(CDeviceBase::SlaveAddr, reg_loc, count, values, listDut);
 #endif
+    
+    // keep what was written for the read back
+    if ( (this->Written != NULL) && this->Written->Open() )
+        this->Written->Stage(page, reg_loc, count, values, listDut);
+    
+    // and what each site has now
+    byte pg = WriteLog::Page(page);
+    if (pg < NUM_PAGES)
+    {
+        int dut;
+        for (int a = 0; (a < count) && (reg_loc + a < MAX_PAGE_SIZE); a++)
+        {
+            for (int d = 0; listDut[d] != 0; d++)
+            {
+                dut = listDut[d] - 1;
+                this->Shadow[pg][reg_loc + a][dut] = values[(a * TOOL_MAX_DUT) + dut];
+                this->Known[pg][reg_loc + a][dut] = 0xFF;
+            }
+        }
+    }
 }
 
 /******************************************************************************
@@ -152,32 +179,47 @@ void CDeviceBase::SetByte(byte page, byte reg_loc, int count, byte* values, word
             register or registers of an ASIC and modifies into readable form
             based on the ASICregister it is from.
 ******************************************************************************/
-void CDeviceBase::GetRegister(ASICregister reg, byte* output, word* listDut)
+void CDeviceBase::GetRegister(const ASICregister& reg, byte* output, word* listDut)
 {
     DBGTrace("---> CDeviceBase::GetRegister (byte)");
     
-    // Multiple addresses
+    // Multiple addresses (one burst per run of consecutive addresses)
     if (reg.addr[1] != ADDR_INVALID)
     {
-        int index;
+        int first[APP_MAX_ADDR], count[APP_MAX_ADDR];
+        int runs = reg.Runs(first, count);
         
-        for (int a = 0; a < reg.num_registers; a++)
+        for (int r = 0; r < runs; r++)
         {
-            if (reg.addr[a] != ADDR_INVALID)
-            {
-                String reg_name;
-                sprintf(reg_name,"%s(%1i)", reg.name.c_str(), a);
-                
-                index = (a * TOOL_MAX_DUT);
-                this->GetByte(reg.page, reg.addr[a], 1, &output[index], listDut, string(reg_name));
-            }
+            String reg_name;
+            sprintf(reg_name,"%s(%1i)", reg.name, first[r]);
+            
+            this->GetByte(reg.page, reg.addr[first[r]], count[r], &output[first[r] * TOOL_MAX_DUT], listDut, reg_name);
         }
         reg.MaskAndShift(output, listDut);
     }
-    // Single address but multiple consecutive bytes (assume mask = 0xFF)
+    // Single address but multiple consecutive bytes (assume mask = 0xFF),
+    // one burst per run of bytes that can be read (see SkipRead)
     else if (reg.num_registers > 1)
     {
-        this->GetByte(reg.page, reg.addr[0], reg.num_registers, output, listDut, reg.name);
+        byte page = WriteLog::Page(reg.page);
+        int start;
+        
+        for (int a = 0; a < reg.num_registers; a++)
+        {
+            if ( (page < NUM_PAGES) && (reg.addr[0] + a < MAX_PAGE_SIZE) && (this->NoRead[page][reg.addr[0] + a] != 0) )
+            {
+                memset(&output[a * TOOL_MAX_DUT], 0x00, TOOL_MAX_DUT);
+                continue;
+            }
+            
+            start = a;
+            while ( (a + 1 < reg.num_registers) && !( (page < NUM_PAGES) && (reg.addr[0] + a + 1 < MAX_PAGE_SIZE) &&
+                (this->NoRead[page][reg.addr[0] + a + 1] != 0) ) )
+                a++;
+            
+            this->GetByte(reg.page, (byte)(reg.addr[0] + start), (a - start) + 1, &output[start * TOOL_MAX_DUT], listDut, reg.name);
+        }
     }
     // Single byte
     else
@@ -193,7 +235,7 @@ void CDeviceBase::GetRegister(ASICregister reg, byte* output, word* listDut)
             into information in an expected format for a particular register
             or registers of an ASIC
 ******************************************************************************/
-void CDeviceBase::GetRegister(ASICregister reg, int* output, word* listDut)
+void CDeviceBase::GetRegister(const ASICregister& reg, int* output, word* listDut)
 {
     DBGTrace("---> CDeviceBase::GetRegister (int)");
     
@@ -213,11 +255,12 @@ void CDeviceBase::GetRegister(ASICregister reg, int* output, word* listDut)
             register or registers of an ASIC after modifying it to fit into the
             designated register(s).
 ******************************************************************************/
-void CDeviceBase::SetRegister(ASICregister reg, byte* input, word* listDut)
+void CDeviceBase::SetRegister(const ASICregister& reg, byte* input, word* listDut)
 {
     DBGTrace("---> CDeviceBase::SetRegister (byte)");
     
-    string origName = "orig: " + reg.name;
+    String origName;
+    sprintf(origName, "orig: %s", reg.name);
     
     byte original[APP_MAX_ADDR][TOOL_MAX_DUT];
     memset(original, 0, sizeof(original));
@@ -225,8 +268,6 @@ void CDeviceBase::SetRegister(ASICregister reg, byte* input, word* listDut)
     // Multiple addresses
     if (reg.addr[1] != ADDR_INVALID)
     {
-        int index;
-        
         for (int a = 0; a < reg.num_registers; a++)
         {
             // if mask = 0xFF, then we're overwriting anyway
@@ -235,20 +276,24 @@ void CDeviceBase::SetRegister(ASICregister reg, byte* input, word* listDut)
         }
         reg.ShiftAndMask(&original[0][0], input, listDut);
         
-        for (int a = 0; a < reg.num_registers; a++)
+        // read back all of the addresses at once
+        bool verify = (DBGVerify >= ENG_LEVEL_2);
+        if (verify)
+            this->BeginVerify();
+        
+        // one burst per run of consecutive addresses
+        int first[APP_MAX_ADDR], count[APP_MAX_ADDR];
+        int runs = reg.Runs(first, count);
+        
+        for (int r = 0; r < runs; r++)
         {
-            if (reg.addr[a] != ADDR_INVALID)
-            {
-                index = (a * TOOL_MAX_DUT);
-                
-                String reg_name;
-                sprintf(reg_name,"%s(%1i)", reg.name.c_str(), a);
-                if (DBGVerify >= ENG_LEVEL_2)
-                    this->VerifySetByte(reg.page, reg.addr[a], 1, &input[index], listDut, string(reg_name));
-                else
-                    this->SetByte(reg.page, reg.addr[a], 1, &input[index], listDut, string(reg_name));
-            }
+            String reg_name;
+            sprintf(reg_name,"%s(%1i)", reg.name, first[r]);
+            this->SetByte(reg.page, reg.addr[first[r]], count[r], &input[first[r] * TOOL_MAX_DUT], listDut, reg_name);
         }
+        
+        if (verify)
+            this->EndVerify(listDut);
     }
     // Single address but multiple consecutive bytes (assume mask = 0xFF)
     else if (reg.num_registers > 1)
@@ -284,7 +329,7 @@ void CDeviceBase::SetRegister(ASICregister reg, byte* input, word* listDut)
     Desc:   Organizes values into particular bits or a byte within an ASIC
             register, and then sets the info using SetByte
 ******************************************************************************/
-void CDeviceBase::SetRegister(ASICregister reg, int* input, word* listDut)
+void CDeviceBase::SetRegister(const ASICregister& reg, int* input, word* listDut)
 {
     DBGTrace("---> CDeviceBase::SetRegister (int)");
     
@@ -307,7 +352,7 @@ void CDeviceBase::SetRegister(ASICregister reg, int* input, word* listDut)
     Desc:   Takes a single byte input and sets it to the specified register for
             all DUTs
 ******************************************************************************/
-void CDeviceBase::SetRegister(ASICregister reg, byte inputIn, word* listDut)
+void CDeviceBase::SetRegister(const ASICregister& reg, byte inputIn, word* listDut)
 {
     if (reg.num_registers > 1)
     {
@@ -332,10 +377,11 @@ void CDeviceBase::SetRegister(ASICregister reg, byte inputIn, word* listDut)
     Desc:   Takes a single integer input and sets it to the specified register
             for all DUTs
 ******************************************************************************/
-void CDeviceBase::SetRegister(ASICregister reg, int inputIn, word* listDut)
+void CDeviceBase::SetRegister(const ASICregister& reg, int inputIn, word* listDut)
 {
     int dut;
     int input[TOOL_MAX_DUT];
+    memset(input,0,sizeof(input));
     for (int d = 0; listDut[d] != 0; d++)
     {
         dut = listDut[d] - 1;
@@ -350,17 +396,22 @@ void CDeviceBase::SetRegister(ASICregister reg, int inputIn, word* listDut)
     Desc:   Verifies input will fit within specified range for ASICregister.
             Usese Range function to determine min and max based on conversion.
 ******************************************************************************/
-void CDeviceBase::CheckRange(ASICregister reg, int* input, word* listDut)
+void CDeviceBase::CheckRange(const ASICregister& reg, int* input, word* listDut)
 {
     String msg;
     int dut, min, max;
+    bool inrange[TOOL_MAX_DUT];
+    
+    // check every site at once, only report when something failed
+    if (reg.InRange(input, inrange, listDut))
+        return;
     
     reg.Range(&min, &max);
     
     for (int d = 0; listDut[d] != 0; d++)
     {
         dut = listDut[d] - 1;
-        if ((input[dut] < min) || (max < input[dut]))
+        if (!inrange[dut])
         {
             sprintf(msg, "Input %i for %s is outside range (%i, %i) for site %i.", input[dut], reg.name, min, max, dut+1);
             ERRChk(ERROR_ASIC_SPECIFIC, msg);
@@ -368,11 +419,59 @@ void CDeviceBase::CheckRange(ASICregister reg, int* input, word* listDut)
     }
 }
 
+/******************************************************************************
+    Name:   WaitUntil
+    Desc:   Reads a single byte register (masked and shifted) of every site
+            still waiting, in one read, until it reads value.  Each site is
+            dropped from the reads as soon as it gets there.  Gives up after
+            timeout ms and returns the number of sites still waiting.
+******************************************************************************/
+int CDeviceBase::WaitUntil(const ASICregister& reg, byte value, int timeout, word* listDut)
+{
+    DBGTrace("---> CDeviceBase::WaitUntil");
+    
+    String msg;
+    int num = 0;
+    word waitDut[TOOL_MAX_DUT + 1];
+    byte status[APP_MAX_ADDR][TOOL_MAX_DUT];
+    dword start = GetTickCount();
+    
+    for (int d = 0; listDut[d] != 0; d++)
+        waitDut[num++] = listDut[d];
+    waitDut[num] = 0;
+    
+    while (num > 0)
+    {
+        memset(status, 0, sizeof(status));
+        this->GetRegister(reg, &status[0][0], waitDut);
+        
+        // keep only the sites that aren't there yet
+        num = 0;
+        for (int d = 0; waitDut[d] != 0; d++)
+        {
+            if (status[0][waitDut[d] - 1] != value)
+                waitDut[num++] = waitDut[d];
+        }
+        waitDut[num] = 0;
+        
+        if (GetTickCount() - start >= (dword)timeout)
+            break;
+    }
+    
+    if (num > 0)
+    {
+        sprintf(msg, "%i site(s) did not read %s = 0x%02X within %i ms", num, reg.name, value, timeout);
+        ERRWarn(msg);
+    }
+    
+    return num;
+}
+
 /******************************************************************************
     Name:   VerifySetByte
     Desc:   Debug SetByte function
 ******************************************************************************/
-void CDeviceBase::VerifySetByte(byte page, byte reg_loc, byte value, word* listDut, string label)
+void CDeviceBase::VerifySetByte(byte page, byte reg_loc, byte value, word* listDut, const char* label)
 {
     //DBGTrace("---> CDeviceBase::VerifySetByte");
     
@@ -385,7 +484,7 @@ void CDeviceBase::VerifySetByte(byte page, byte reg_loc, byte value, word* listD
     Name:   VerifySetByte
     Desc:   Debug SetByte function
 ******************************************************************************/
-void CDeviceBase::VerifySetByte(byte page, byte reg_loc, byte* values, word* listDut, string label)
+void CDeviceBase::VerifySetByte(byte page, byte reg_loc, byte* values, word* listDut, const char* label)
 {
     //DBGTrace("---> CDeviceBase::VerifySetByte");
     
@@ -393,32 +492,223 @@ void CDeviceBase::VerifySetByte(byte page, byte reg_loc, byte* values, word* lis
 }
 /******************************************************************************
     Name:   VerifySetByte
-    Desc:   Debug SetByte function
+    Desc:   SetByte and read it back.  Inside BeginVerify/EndVerify the read
+            back is left for EndVerify, so all writes are checked at once.
 ******************************************************************************/
-void CDeviceBase::VerifySetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, string label)
+void CDeviceBase::VerifySetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, const char* label)
 {
     DBGTrace("---> CDeviceBase::VerifySetByte");
     
+    this->BeginVerify();
+    this->SetByte(page, reg_loc, count, values, listDut, label);
+    this->EndVerify(listDut, NULL, label);
+}
+
+/******************************************************************************
+    Name:   ForgetShadow
+    Desc:   Marks every register of each site as unknown (after a reset or
+            power cycle)
+******************************************************************************/
+void CDeviceBase::ForgetShadow(word* listDut)
+{
+    int dut;
+    for (int pg = 0; pg < NUM_PAGES; pg++)
+    {
+        for (int a = 0; a < MAX_PAGE_SIZE; a++)
+        {
+            for (int d = 0; listDut[d] != 0; d++)
+            {
+                dut = listDut[d] - 1;
+                this->Known[pg][a][dut] = 0x00;
+            }
+        }
+    }
+}
+
+/******************************************************************************
+    Name:   BeginVerify
+    Desc:   Starts (or nests) a verified write.  SetByte keeps the expected
+            value of every byte written until the matching EndVerify.
+******************************************************************************/
+void CDeviceBase::BeginVerify(void)
+{
+    DBGTrace("---> CDeviceBase::BeginVerify");
+    
+    if (this->Written == NULL)
+        this->Written = new WriteLog;
+    
+    if (this->Written->depth == 0)
+        this->Written->Clear();
+    
+    this->Written->depth++;
+}
+
+/******************************************************************************
+    Name:   EndVerify
+    Desc:   Ends a verified write.  The outermost EndVerify reads back every
+            run of bytes written in one burst, compares against what was
+            written and reports each register and site that doesn't match
+            (by label if one is given, else by register name), with the
+            values written and read.  With DBGVerify >= ENG_LEVEL_2 the
+            bytes that did match are displayed too.
+            Bits that can't be read back (see SkipVerify) are left out, and
+            bytes with none left aren't read at all.
+            result (optional) is false for failed sites.
+            Returns true if everything matched.
+******************************************************************************/
+bool CDeviceBase::EndVerify(word* listDut, bool* result, const char* label)
+{
+    DBGTrace("---> CDeviceBase::EndVerify");
+    
     String msg;
+    int dut;
+    word failed[MAX_PAGE_SIZE];
+    word all = 0;
     
-    // always display
-    int was_on = DBGVerify;
-    DBGVerify = max(YES,DBGVerify);
+    if (result != NULL)
+    {
+        for (int i = 0; i < TOOL_MAX_DUT; i++)
+            result[i] = true;
+    }
     
-    byte output[MAX_RAM_SIZE][TOOL_MAX_DUT];
-    this->GetByte(page, reg_loc, count, &output[0][0], listDut, label);
-    if (count > 1)
-        DBGVerbose("");
+    if ( (this->Written == NULL) || (this->Written->depth == 0) )
+    {
+        ERRWarn("EndVerify called without BeginVerify");
+        return true;
+    }
     
-    this->SetByte(page, reg_loc, count, values, listDut, label);
+    // still nested
+    if (--this->Written->depth > 0)
+        return true;
     
-    if (count > 1)
-        DBGVerbose("");
-    memset(output, 0, sizeof(output));
-    this->GetByte(page, reg_loc, count, &output[0][0], listDut, label);
+    WriteLog& log = *this->Written;
     
-    if (DBGVerify >= ENG_LEVEL_2)
-        DBGPrint("");
+    for (byte page = 0; page < NUM_PAGES; page++)
+    {
+        int first = log.first[page];
+        int last = log.last[page];
+        
+        if (last < first)
+            continue;
+        
+        // one burst for each run of bytes written (bytes in between are not
+        // read, some registers clear on read)
+        memset(log.Readback, 0x00, sizeof(log.Readback));
+        
+        for (int i = first; i <= last; i++)
+        {
+            if ( (log.Sites[page][i] == 0) || (this->NoVerify[page][i] == 0xFF) )
+                continue;
+            
+            int start = i;
+            while ( (i < last) && (log.Sites[page][i + 1] != 0) && (this->NoVerify[page][i + 1] != 0xFF) )
+                i++;
+            
+            this->GetByte(page, (byte)start, (i - start) + 1, &log.Readback[start - first][0], listDut, "verify");
+        }
+        
+        word page_failed = log.Compare(page, this->NoVerify[page], failed);
+        all |= page_failed;
+        
+        if ( (page_failed == 0) && (DBGVerify < ENG_LEVEL_2) )
+            continue;
+        
+        // report each byte and site
+        for (int i = first; i <= last; i++)
+        {
+            if ( (log.Sites[page][i] == 0) || (this->NoVerify[page][i] == 0xFF) )
+                continue;
+            
+            if ( (failed[i] == 0) && (DBGVerify < ENG_LEVEL_2) )
+                continue;
+            
+            const char* name = label;
+            if ( (name == NULL) || (name[0] == 0) )
+                name = this->Registers.Name(this->Registers.Find(page, (byte)i));
+            
+            for (int d = 0; listDut[d] != 0; d++)
+            {
+                dut = listDut[d] - 1;
+                
+                bool bad = (((failed[i] >> dut) & 1) != 0);
+                
+                if ( (((log.Sites[page][i] >> dut) & 1) == 0) || (!bad && (DBGVerify < ENG_LEVEL_2)) )
+                    continue;
+                
+                sprintf(msg, "Verify %s for %s (page %i, 0x%02X) on site %i: wrote 0x%02X, read 0x%02X",
+                    bad ? "failed" : "passed", name, page, i, dut+1,
+                    log.Expected[page][i][dut], log.Readback[i - first][dut]);
+                
+                if (bad)
+                {
+                    ERRChk(ERROR_ASIC_SPECIFIC, msg);
+                    
+                    if (result != NULL)
+                        result[dut] = false;
+                }
+                else
+                    DBGVerbose(msg);
+            }
+        }
+    }
+    
+    log.Clear();
+    
+    return (all == 0);
+}
+
+/******************************************************************************
+    Name:   SkipVerify
+    Desc:   Leaves the bits of a register out of EndVerify.  Called by the
+            unique ASIC for registers that don't read back what was written
+            (write-only keys, self-clearing bits, FIFO ports, OTP).
+******************************************************************************/
+void CDeviceBase::SkipVerify(const ASICregister& reg)
+{
+    CDeviceBase::MarkBits(reg, this->NoVerify);
+}
+
+/******************************************************************************
+    Name:   SkipRead
+    Desc:   Leaves a register out of the bursts that read multiple
+            consecutive registers (like RawVOLATILE).  Called by the unique
+            ASIC for registers that act when read, like a FIFO port.
+******************************************************************************/
+void CDeviceBase::SkipRead(const ASICregister& reg)
+{
+    CDeviceBase::MarkBits(reg, this->NoRead);
+}
+
+/******************************************************************************
+    Name:   MarkBits
+    Desc:   Sets the bits reg uses in bits[NUM_PAGES][MAX_PAGE_SIZE] (a whole
+            byte for each of multiple consecutive registers)
+******************************************************************************/
+void CDeviceBase::MarkBits(const ASICregister& reg, byte bits[NUM_PAGES][MAX_PAGE_SIZE])
+{
+    byte page = WriteLog::Page(reg.page);
     
-    DBGVerify = was_on;
+    if (page >= NUM_PAGES)
+        return;
+    
+    // Multiple addresses
+    if (reg.addr[1] != ADDR_INVALID)
+    {
+        for (int a = 0; a < reg.num_registers; a++)
+        {
+            if ( (reg.addr[a] != ADDR_INVALID) && (reg.addr[a] < MAX_PAGE_SIZE) )
+                bits[page][reg.addr[a]] |= reg.mask[a];
+        }
+    }
+    // Single address but multiple consecutive bytes (assume mask = 0xFF)
+    else if (reg.num_registers > 1)
+    {
+        for (int a = 0; (a < reg.num_registers) && (reg.addr[0] + a < MAX_PAGE_SIZE); a++)
+            bits[page][reg.addr[0] + a] = 0xFF;
+    }
+    // Single byte
+    else if (reg.addr[0] < MAX_PAGE_SIZE)
+    {
+        bits[page][reg.addr[0]] |= reg.mask[0];
+    }
 }
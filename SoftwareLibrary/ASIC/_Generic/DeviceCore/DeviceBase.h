@@ -42,6 +42,10 @@ protected:
     
     RAMstruct RAMregisters;
     
+    // every register defined on this ASIC, addressed by regid (filled by
+    // the unique ASIC class from its register map)
+    RegisterTable Registers;
+    
     Default DefaultImage;
     
     Image RAMImage;
@@ -55,17 +59,64 @@ protected:
     
     void SetPage(byte page, word* listDut, byte slave_addr = ADDR_INVALID);
     
-    void GetRegister(ASICregister reg, byte* output, word* listDut);
-    void GetRegister(ASICregister reg, int* output, word* listDut);
+    void GetRegister(const ASICregister& reg, byte* output, word* listDut);
+    void GetRegister(const ASICregister& reg, int* output, word* listDut);
     
-    void SetRegister(ASICregister reg, byte* input, word* listDut);
-    void SetRegister(ASICregister reg, int* input, word* listDut);
+    void SetRegister(const ASICregister& reg, byte* input, word* listDut);
+    void SetRegister(const ASICregister& reg, int* input, word* listDut);
     
     // TODO: Eliminate these when ^those are finished
-    void SetRegister(ASICregister reg, byte input, word* listDut);
-    void SetRegister(ASICregister reg, int input, word* listDut);
+    void SetRegister(const ASICregister& reg, byte input, word* listDut);
+    void SetRegister(const ASICregister& reg, int input, word* listDut);
+    
+    void CheckRange(const ASICregister& reg, int* input, word* listDut);
+    
+    // poll a single byte register of every site until it reads value
+    int WaitUntil(const ASICregister& reg, byte value, int timeout, word* listDut);
+    
+    // access by register ID
+    void GetRegister(regid id, byte* output, word* listDut) { GetRegister(Registers[id], output, listDut); }
+    void GetRegister(regid id, int* output, word* listDut) { GetRegister(Registers[id], output, listDut); }
+    
+    void SetRegister(regid id, byte* input, word* listDut) { SetRegister(Registers[id], input, listDut); }
+    void SetRegister(regid id, int* input, word* listDut) { SetRegister(Registers[id], input, listDut); }
+    void SetRegister(regid id, byte input, word* listDut) { SetRegister(Registers[id], input, listDut); }
+    void SetRegister(regid id, int input, word* listDut) { SetRegister(Registers[id], input, listDut); }
+    
+    // verified writes: every byte written between BeginVerify and EndVerify
+    // is read back in one burst per page and compared when the outermost
+    // EndVerify is called (the log is allocated by the first BeginVerify)
+    WriteLog* Written;
+    
+    // bits that can't be read back as written (write-only keys,
+    // self-clearing bits, FIFO ports and OTP), left out of EndVerify
+    byte NoVerify[NUM_PAGES][MAX_PAGE_SIZE];
     
-    void CheckRange(ASICregister reg, int* input, word* listDut);
+    void BeginVerify(void);
+    bool EndVerify(word* listDut, bool* result = NULL, const char* label = NULL);
+    void SkipVerify(const ASICregister& reg);
+    
+    // bytes that act when read (FIFO ports), left out of the bursts that
+    // read multiple consecutive registers (they read as 0)
+    byte NoRead[NUM_PAGES][MAX_PAGE_SIZE];
+    
+    void SkipRead(const ASICregister& reg);
+    
+    // sets the bits reg uses in bits[NUM_PAGES][MAX_PAGE_SIZE]
+    static void MarkBits(const ASICregister& reg, byte bits[NUM_PAGES][MAX_PAGE_SIZE]);
+    
+    // last byte written to each register of each site (Known is 0xFF where
+    // Shadow still holds what the part has) so unchanged writes can be
+    // skipped
+    byte Shadow[NUM_PAGES][MAX_PAGE_SIZE][TOOL_MAX_DUT];
+    byte Known[NUM_PAGES][MAX_PAGE_SIZE][TOOL_MAX_DUT];
+    
+    void ForgetShadow(word* listDut);
+
+private:
+    // owns the write log (not copied)
+    CDeviceBase(const CDeviceBase&);
+    CDeviceBase& operator=(const CDeviceBase&);
 
 public:
     CDeviceBase(void);
@@ -73,20 +124,20 @@ public:
     
     //RAMValueStruct RAMValues;
     
-    void GetByte(byte page, byte reg_loc, byte* values, word* listDut, string label = "");
-    void GetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, string label = "");
+    void GetByte(byte page, byte reg_loc, byte* values, word* listDut, const char* label = "");
+    void GetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, const char* label = "");
     
-    void SetByte(byte page, byte reg_loc, byte value, word* listDut, string label = "");
-    void SetByte(byte page, byte reg_loc, byte* values, word* listDut, string label = "");
-    void SetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, string label = "");
+    void SetByte(byte page, byte reg_loc, byte value, word* listDut, const char* label = "");
+    void SetByte(byte page, byte reg_loc, byte* values, word* listDut, const char* label = "");
+    void SetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, const char* label = "");
     
     // verify communication
-    void VerifySetByte(byte page, byte reg_loc, byte value, word* listDut, string label = "");
-    void VerifySetByte(byte page, byte reg_loc, byte* values, word* listDut, string label = "");
-    void VerifySetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, string label = "");
+    void VerifySetByte(byte page, byte reg_loc, byte value, word* listDut, const char* label = "");
+    void VerifySetByte(byte page, byte reg_loc, byte* values, word* listDut, const char* label = "");
+    void VerifySetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, const char* label = "");
     
-    void FakeGetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, string label);
-    void FakeSetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, string label);
+    void FakeGetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, const char* label);
+    void FakeSetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, const char* label);
 };
 
 #endif
\ No newline at end of file
@@ -13,21 +13,28 @@
 #ifdef _USE_FAKE_MEMORY_
     byte CDeviceBase::FakeMemory[NUM_PAGES][MAX_PAGE_SIZE][TOOL_MAX_DUT];
     
+    inline byte FakePage(byte page) { return (page == 255) ? 0 : page; }
+    
     /******************************************************************************
         Name:   GetByte
         Desc:   Read from device registers in FakeMemory
     ******************************************************************************/
-    void CDeviceBase::FakeGetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, string label)
+    void CDeviceBase::FakeGetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, const char* label)
     {
-        int dut;
-        if (page == 255)
-            page = 0;
+        int dut, addr;
+        page = FakePage(page);
         for (int a = 0; a < count; a++)
         {
+            addr = reg_loc + a;
             for (int d = 0; listDut[d] != 0; d++)
             {
                 dut = listDut[d] - 1;
-                values[(a * TOOL_MAX_DUT) + dut] = FakeMemory[page][reg_loc + a][dut];
+                if (addr >= MAX_PAGE_SIZE)
+                {
+                    values[(a * TOOL_MAX_DUT) + dut] = 0;
+                    continue;
+                }
+                values[(a * TOOL_MAX_DUT) + dut] = FakeMemory[page][addr][dut];
             }
         }
     }
@@ -36,12 +43,11 @@
         Name:   FakeSetByte
         Desc:   Write to device registers in FakeMemory
     ******************************************************************************/
-    void CDeviceBase::FakeSetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, string label)
+    void CDeviceBase::FakeSetByte(byte page, byte reg_loc, int count, byte* values, word* listDut, const char* label)
     {
         int dut;
-        if (page == 255)
-            page = 0;
-        for (int a = 0; a < count; a++)
+        page = FakePage(page);
+        for (int a = 0; (a < count) && (reg_loc + a < MAX_PAGE_SIZE); a++)
         {
             for (int d = 0; listDut[d] != 0; d++)
             {
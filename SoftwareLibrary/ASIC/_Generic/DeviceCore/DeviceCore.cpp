@@ -8,6 +8,9 @@
 ******************************************************************************/
 #include "DeviceCore.h"
 
+// VerifyROM combines the banks as 2 pairs of single-ended reads
+STATIC_CHECK(MAX_NUM_BANKS == 4, VerifyROM_combines_4_banks);
+
 /******************************************************************************
     Name:   CDeviceCore
     Desc:   Default constructor
@@ -15,6 +18,16 @@
 CDeviceCore::CDeviceCore(void)
 {
     memset(this->SingleEnded, 0x00, sizeof(this->SingleEnded));
+    memset(this->NoRestore, 0x00, sizeof(this->NoRestore));
+    memset(this->NoShadow, 0x00, sizeof(this->NoShadow));
+#ifdef _OTP_BURN_
+    this->BURN = BURN_INVALID;
+#endif
+    this->SavedSites = 0;
+    this->MemDepth = 0;
+    this->MemSettled = false;
+    for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+        this->MemAccess[dut] = STATE_DEVICE_UNKNOWN;
     this->RAMImage = Image(RAM, RAM_PG);
     this->ROMImage = Image(ROM, ROM_PG);
     
@@ -54,6 +67,9 @@ void CDeviceCore::Init(char* DefaultImg, char* DefaultMask)
     
     // check proper setup of RAMregisters
     this->RAMregisters.Check();
+    
+    // precompile conversion of the RAM image
+    this->RAMregisters.CompilePlan(this->RawRAM);
 }
 
 /******************************************************************************
@@ -79,7 +95,8 @@ void CDeviceCore::HardwareReset(word* listDut, double vdd)
     this->Tool->PowerOnPart(vdd, listDut);
     this->Tool->ConnectComm(com, listDut);
     
-    //TIMEDelay(RESET_DELAY);
+    // wait for the power on reset to finish
+    this->WaitUntil(this->REG_RESP, COTR_READY, RESET_DELAY, listDut);
     
     this->SetState(STATE_DEVICE_UNKNOWN, listDut);
     
@@ -98,7 +115,7 @@ void CDeviceCore::HardwareReset(word* listDut, double vdd)
 /******************************************************************************
     Name:   SoftwareReset
     Desc:   Resets the device (software reset) and sets state to ENABLE
-            Includes a RESET_DELAY
+            Waits (up to RESET_DELAY) for the reset to finish
 ******************************************************************************/
 void CDeviceCore::SoftwareReset(word* listDut)
 {
@@ -106,8 +123,9 @@ void CDeviceCore::SoftwareReset(word* listDut)
     
     this->SetState(STATE_DEVICE_DISABLE, listDut);
     this->SetRegister(this->REG_SRST, this->REG_SRST.mask, listDut);
+    this->SetState(STATE_DEVICE_UNKNOWN, listDut);
     
-    //TIMEDelay(RESET_DELAY);
+    this->WaitUntil(this->REG_RESP, COTR_READY, RESET_DELAY, listDut);
     
 #ifdef _TEST_MODE_
     this->TestModeEnable(listDut);
@@ -371,13 +389,15 @@ void CDeviceCore::GetROM(byte* values, word* listDut)
     //this->LV->GetROM(values, listDut);
     ERRChk(ERROR_UNIMPLEMENTED, "GetROM doesn't exist in LabVIEW", "CDeviceCore::GetROM", YES);
 #elif defined(_OTP_)
+    this->BeginMemoryAccess();
+    
     // put the parts into redundant read mode
     this->SetState(STATE_REDUNDANT_READ_MODE, listDut);
     
     this->GetRegister(this->RawROM, values, listDut);
     
-    // lock memory access
-    this->SetState(STATE_LOCK_MEMORY_ACCESS, listDut);
+    // lock memory access (unless the caller has a window open)
+    this->EndMemoryAccess(listDut);
 #else
     // TODO: for _EEPROM_
 #endif
@@ -391,6 +411,73 @@ void CDeviceCore::GetROM(byte* values, word* listDut)
     }
 }
 
+/******************************************************************************
+    Name:   BankSelect
+    Desc:   Works out the OTPAC byte that selects each bank (same as
+            SetRegister(REG_OTPAC, bank)) from a single read of OTPAC
+******************************************************************************/
+void CDeviceCore::BankSelect(byte select[MAX_NUM_BANKS][TOOL_MAX_DUT], word* listDut)
+{
+    DBGTrace("--> CDeviceCore::BankSelect");
+    
+    const ASICregister& otpac = this->REG_OTPAC;
+    byte original[TOOL_MAX_DUT];
+    
+    memset(original, 0, sizeof(original));
+    
+    // if mask = 0xFF, then we're overwriting anyway
+    if (otpac.mask[0] != 0xFF)
+        this->GetByte(otpac.page, otpac.addr[0], original, listDut, "orig: OTPAC");
+    
+    for (int bank = 0; bank < MAX_NUM_BANKS; bank++)
+    {
+        memset(select[bank], bank, TOOL_MAX_DUT);
+        
+        if (otpac.mask[0] != 0xFF)
+            otpac.ShiftAndMask(original, select[bank], listDut);
+    }
+}
+
+/******************************************************************************
+    Name:   SelectBank
+    Desc:   Writes the OTPAC byte (from BankSelect) for one bank
+******************************************************************************/
+void CDeviceCore::SelectBank(byte* select, word* listDut)
+{
+    const ASICregister& otpac = this->REG_OTPAC;
+    
+    if (DBGVerify)
+        this->VerifySetByte(otpac.page, otpac.addr[0], select, listDut, otpac.name);
+    else
+        this->SetByte(otpac.page, otpac.addr[0], select, listDut, otpac.name);
+}
+
+/******************************************************************************
+    Name:   CaptureBanks
+    Desc:   Reads every single-ended OTP bank into SingleEnded as one
+            back-to-back sequence.  OTPAC is read once and the bank select
+            byte for every bank is worked out up front, so each bank is just
+            one OTPAC write and one burst read of RawROM.
+            NOTE: parts must already be in single-ended read mode
+******************************************************************************/
+void CDeviceCore::CaptureBanks(word* listDut)
+{
+    DBGTrace("--> CDeviceCore::CaptureBanks");
+    
+    byte select[MAX_NUM_BANKS][TOOL_MAX_DUT];
+    
+    this->BankSelect(select, listDut);
+    
+    // select and read each of the banks
+    for (int bank = 0; bank < MAX_NUM_BANKS; bank++)
+    {
+        this->SelectBank(select[bank], listDut);
+        
+        this->GetByte(this->RawROM.page, this->RawROM.addr[0], this->RawROM.num_registers,
+            &this->SingleEnded[bank][0][0], listDut, this->RawROM.name);
+    }
+}
+
 /******************************************************************************
     Name:   VerifyROM
     Desc:   
@@ -399,8 +486,6 @@ void CDeviceCore::VerifyROM(int burned, bool* result, byte* difference, word* li
 {
     DBGTrace("--> CDeviceCore::VfyPROM");
     
-    int dut;
-    byte mask, bank0, bank1, bank2, bank3;
     byte check[NUM_ROM_REG][TOOL_MAX_DUT];
     byte CombinedRead[NUM_ROM_REG][TOOL_MAX_DUT];
     Image ROMcheck = Image(ROM, ROM_PG);
@@ -412,48 +497,820 @@ void CDeviceCore::VerifyROM(int burned, bool* result, byte* difference, word* li
     
     ROMcheck.SetRaw(&check[0][0]);
     
+    this->BeginMemoryAccess();
+    
     // put the parts in single-ended read mode
     this->SetState(STATE_SINGLE_ENDED_READ_MODE, listDut);
     
     // read each of the banks
+    this->CaptureBanks(listDut);
+    
+    // combine the banks together, a bit is burned when
+    // (bank0 == bank1) && (bank2 == bank3) && (bank0 != bank3)
+    const byte* bank0 = &this->SingleEnded[0][0][0];
+    const byte* bank1 = &this->SingleEnded[1][0][0];
+    const byte* bank2 = &this->SingleEnded[2][0][0];
+    const byte* bank3 = &this->SingleEnded[3][0][0];
+    byte* combined = &CombinedRead[0][0];
+    
+    for (int i = 0; i < NUM_ROM_REG * TOOL_MAX_DUT; i++)
+        combined[i] = (byte)( ~(bank0[i] ^ bank1[i]) & ~(bank2[i] ^ bank3[i]) & (bank0[i] ^ bank3[i]) );
+    
+    // do actual check if burned or not
+    //TODO: Ignore SN registers?
+    ROMcheck.Compare(&CombinedRead[0][0], difference, result, listDut);
+    
+    // put the parts back into redundant read mode
+    this->SetState(STATE_REDUNDANT_READ_MODE, listDut);
+    
+    // lock memory access (unless the caller has a window open)
+    this->EndMemoryAccess(listDut);
+}
+
+#ifdef _OTP_BURN_
+/******************************************************************************
+    Name:   ProgramROM
+    Desc:   Burns target (raw [NUM_ROM_REG][TOOL_MAX_DUT] image) into the OTP.
+            Every bit is kept in 2 pairs of single-ended banks (banks 0 and 1
+            hold the bit, banks 2 and 3 its complement, see VerifyROM) and
+            fuses only go 0->1, so only fuses not burned yet are pulsed:
+              - read all banks and work out the fuses each bank still needs
+                (sites with a fuse burned that the target needs clear fail)
+              - for each bank, burn each run of registers that needs fuses,
+                all sites at once (one burn delay per run, not per site)
+              - read the bank back and burn again only the weak fuses (up to
+                BURN_RETRIES times)
+            The ROM is then checked in redundant read mode.  result is false
+            for sites that could not be programmed.  Returns the number of
+            burn pulses.
+******************************************************************************/
+int CDeviceCore::ProgramROM(byte* target, bool* result, word* listDut)
+{
+    DBGTrace("--> CDeviceCore::ProgramROM");
+    
+    String msg;
+    int dut, index;
+    int pulses = 0;
+    word sites = 0;
+    word failed = 0;
+    byte enable[TOOL_MAX_DUT];
+    byte select[MAX_NUM_BANKS][TOOL_MAX_DUT];
+    byte need[MAX_NUM_BANKS][NUM_ROM_REG][TOOL_MAX_DUT];
+    byte readback[NUM_ROM_REG][TOOL_MAX_DUT];
+    
+    for (int i = 0; i < TOOL_MAX_DUT; i++)
+        result[i] = true;
+    
+    if (this->BURN == BURN_INVALID)
+    {
+        ERRChk(ERROR_UNIMPLEMENTED, "No OTP burn mode is defined for this ASIC", "CDeviceCore::ProgramROM", YES);
+        for (int d = 0; listDut[d] != 0; d++)
+            result[listDut[d] - 1] = false;
+        return 0;
+    }
+    
+    sites = ImageCompare::Sites(listDut, enable);
+    
+    this->BeginMemoryAccess();
+    
+    // fuses already burned in each bank
+    this->SetState(STATE_SINGLE_ENDED_READ_MODE, listDut);
+    this->CaptureBanks(listDut);
+    
+    // fuses still needed
     for (int bank = 0; bank < MAX_NUM_BANKS; bank++)
     {
-        this->SetRegister(this->REG_OTPAC, (byte)bank, listDut);
+        const byte* burned = &this->SingleEnded[bank][0][0];
+        byte* out = &need[bank][0][0];
+        byte invert = (bank < (MAX_NUM_BANKS / 2)) ? 0x00 : 0xFF;
         
-        this->GetRegister(this->RawROM, &this->SingleEnded[bank][0][0], listDut);
+        for (int i = 0; i < NUM_ROM_REG * TOOL_MAX_DUT; i++)
+        {
+            byte want = (target[i] ^ invert) & enable[i % TOOL_MAX_DUT];
+            out[i] = want & ~burned[i];
+            
+            // can't un-burn a fuse
+            if (burned[i] & ~want & enable[i % TOOL_MAX_DUT])
+                failed |= (1 << (i % TOOL_MAX_DUT));
+        }
+    }
+    
+    // don't burn sites that can't reach the target
+    for (int d = 0; listDut[d] != 0; d++)
+    {
+        dut = listDut[d] - 1;
+        if ((failed >> dut) & 1)
+        {
+            sprintf(msg, "Site %i has OTP bits burned that the target image needs clear", dut+1);
+            ERRChk(ERROR_ASIC_SPECIFIC, msg);
+            
+            for (int bank = 0; bank < MAX_NUM_BANKS; bank++)
+                for (int reg = 0; reg < NUM_ROM_REG; reg++)
+                    need[bank][reg][dut] = 0x00;
+        }
     }
     
-    // combine the banks together
-    memset(CombinedRead, 0, sizeof(CombinedRead));
+    this->BankSelect(select, listDut);
+    Tool->SetBurnVoltage(BURN_VOLTAGE);
     
-    for (int reg = 0; reg < NUM_ROM_REG; reg++)
+    for (int bank = 0; bank < MAX_NUM_BANKS; bank++)
     {
-        for (int bit = 0; bit < 8; bit++)
+        for (int attempt = 0; attempt <= BURN_RETRIES; attempt++)
         {
-            mask = (byte)(0x01 << bit);
+            // burn
+            this->SetState(STATE_BURN_MODE, listDut);
+            this->SelectBank(select[bank], listDut);
+            
+            int burned = this->BurnRuns(&need[bank][0][0], listDut);
+            if (burned == 0)
+                break;
+            pulses += burned;
+            
+            // read the bank back, anything still needed is weak
+            this->SetState(STATE_SINGLE_ENDED_READ_MODE, listDut);
+            this->GetByte(this->RawROM.page, this->RawROM.addr[0], this->RawROM.num_registers,
+                &readback[0][0], listDut, this->RawROM.name);
             
+            for (int i = 0; i < NUM_ROM_REG * TOOL_MAX_DUT; i++)
+                (&need[bank][0][0])[i] &= ~(&readback[0][0])[i];
+        }
+    }
+    
+#ifdef _BURN_WITH_VPP_
+    Tool->SetBurnVoltage(0.0);
+#else
+    Tool->SetBurnVoltage(Tool->GetOpVDD());
+#endif
+    
+    // weak fuses left after the retries
+    for (int bank = 0; bank < MAX_NUM_BANKS; bank++)
+    {
+        for (int reg = 0; reg < NUM_ROM_REG; reg++)
+        {
             for (int d = 0; listDut[d] != 0; d++)
             {
                 dut = listDut[d] - 1;
-                
-                bank0 = SingleEnded[0][reg][dut] & mask;
-                bank1 = SingleEnded[1][reg][dut] & mask;
-                bank2 = SingleEnded[2][reg][dut] & mask;
-                bank3 = SingleEnded[3][reg][dut] & mask;
-                
-                if ( (bank0 == bank1) && (bank2 == bank3) && (bank0 != bank3) )
-                    CombinedRead[reg][dut] |= mask;
+                if (need[bank][reg][dut] != 0)
+                    failed |= (1 << dut);
             }
         }
     }
     
-    // do actual check if burned or not
-    //TODO: Ignore SN registers?
-    ROMcheck.Compare(&CombinedRead[0][0], difference, result, listDut);
+    // check the programmed value
+    this->SetState(STATE_REDUNDANT_READ_MODE, listDut);
+    this->GetRegister(this->RawROM, &readback[0][0], listDut);
     
-    // put the parts back into redundant read mode
+    byte diff[NUM_ROM_REG][TOOL_MAX_DUT];
+    word pass = ImageCompare::Diff(&readback[0][0], target, NULL, NUM_ROM_REG, &diff[0][0], listDut);
+    
+    // lock memory access (unless the caller has a window open)
+    this->EndMemoryAccess(listDut);
+    
+    for (int d = 0; listDut[d] != 0; d++)
+    {
+        dut = listDut[d] - 1;
+        index = ((pass & ~failed) >> dut) & 1;
+        result[dut] = (index != 0);
+        
+        if ( !result[dut] && !((failed >> dut) & 1) )
+        {
+            sprintf(msg, "Site %i OTP does not match the target image after burning", dut+1);
+            ERRChk(ERROR_ASIC_SPECIFIC, msg);
+        }
+    }
+    
+    return pulses;
+}
+
+/******************************************************************************
+    Name:   BurnRuns
+    Desc:   Burns each run of consecutive registers in bits ([NUM_ROM_REG]
+            [TOOL_MAX_DUT]) that has a fuse to burn on any site, only to the
+            sites that need it.  Returns the number of burn pulses.
+            NOTE: parts must be in burn mode with the bank selected
+******************************************************************************/
+int CDeviceCore::BurnRuns(byte* bits, word* listDut)
+{
+    int n, start;
+    int pulses = 0;
+    word needs[NUM_ROM_REG];
+    word runDut[TOOL_MAX_DUT + 1];
+    
+    // sites with a fuse to burn in each register
+    for (int reg = 0; reg < NUM_ROM_REG; reg++)
+    {
+        needs[reg] = 0;
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+            needs[reg] |= (word)((bits[(reg * TOOL_MAX_DUT) + dut] != 0) << dut);
+    }
+    
+    for (int reg = 0; reg < NUM_ROM_REG; reg++)
+    {
+        if (needs[reg] == 0)
+            continue;
+        
+        start = reg;
+        word runSites = needs[reg];
+        while ( (reg + 1 < NUM_ROM_REG) && (needs[reg + 1] != 0) )
+            runSites |= needs[++reg];
+        
+        n = 0;
+        for (int d = 0; listDut[d] != 0; d++)
+        {
+            if ((runSites >> (listDut[d] - 1)) & 1)
+                runDut[n++] = listDut[d];
+        }
+        runDut[n] = 0;
+        
+        if (n == 0)
+            continue;
+        
+        this->Burn((byte)start, (reg - start) + 1, &bits[start * TOOL_MAX_DUT], runDut);
+        pulses++;
+    }
+    
+    return pulses;
+}
+
+/******************************************************************************
+    Name:   Burn
+    Desc:   One burn pulse: writes the fuses to burn (1 bits) for
+            num_registers registers at reg_loc to every site at once, then
+            waits the burn delay once for all of them
+            NOTE: parts must be in burn mode with the bank selected
+******************************************************************************/
+void CDeviceCore::Burn(byte reg_loc, int num_registers, byte* bits, word* listDut)
+{
+    DBGTrace("--> CDeviceCore::Burn");
+    
+    this->SetByte(this->RawROM.page, this->RawROM.addr[0] + reg_loc, num_registers, bits, listDut, "burn");
+    
+    Sleep(TOOL_BURN_DELAY);
+}
+#endif
+
+/******************************************************************************
+    Name:   GetSN
+    Desc:   Reads the serial number of each site with one burst read, as
+            values[MAX_SN_SIZE][TOOL_MAX_DUT] (one byte in each, least
+            significant first)
+******************************************************************************/
+void CDeviceCore::GetSN(int* values, word* listDut)
+{
+    DBGTrace("--> CDeviceCore::GetSN");
+    
+    byte sn[APP_MAX_ADDR][TOOL_MAX_DUT];
+    
+    this->GetSpan(this->REG_SN, &sn[0][0], listDut);
+    
+    for (int b = 0; b < this->REG_SN.num_registers; b++)
+    {
+        for (int d = 0; listDut[d] != 0; d++)
+            values[(b * TOOL_MAX_DUT) + listDut[d] - 1] = sn[b][listDut[d] - 1];
+    }
+}
+
+/******************************************************************************
+    Name:   SetSN
+    Desc:   Writes the serial number in values (see GetSN) to each site, one
+            burst per run of consecutive SN addresses
+******************************************************************************/
+void CDeviceCore::SetSN(int* values, word* listDut)
+{
+    DBGTrace("--> CDeviceCore::SetSN");
+    
+    int dut;
+    byte sn[APP_MAX_ADDR][TOOL_MAX_DUT];
+    
+    memset(sn, 0, sizeof(sn));
+    
+    for (int d = 0; listDut[d] != 0; d++)
+    {
+        dut = listDut[d] - 1;
+        
+        for (int b = 0; b < this->REG_SN.num_registers; b++)
+            sn[b][dut] = (byte)values[(b * TOOL_MAX_DUT) + dut];
+    }
+    
+    this->SetRegister(this->REG_SN, &sn[0][0], listDut);
+}
+
+/******************************************************************************
+    Name:   AssignSN
+    Desc:   Gives each site the next unique serial number from SerialPool
+            (one block for all of them), writes it with SetSN and checks it
+            with VfySN.  The serials are returned in values (see GetSN).
+******************************************************************************/
+void CDeviceCore::AssignSN(int* values, word* listDut)
+{
+    DBGTrace("--> CDeviceCore::AssignSN");
+    
+    int dut;
+    int num = 0;
+    qword first, serial;
+    
+    for (int d = 0; listDut[d] != 0; d++)
+        num++;
+    
+    if ( !this->SerialPool.IsOpen() &&
+        (this->SerialPool.Open(SN_POOL_PATH, SN_POOL_NAME, this->REG_SN.num_registers) != SUCCESS) )
+    {
+        ERRChk(ERROR_INIT, "Could not open the serial number pool", "CDeviceCore::AssignSN", YES);
+        return;
+    }
+    
+    if (this->SerialPool.Reserve(num, &first) != SUCCESS)
+    {
+        ERRChk(ERROR_RUN, "Could not get serial numbers", "CDeviceCore::AssignSN", YES);
+        return;
+    }
+    
+    for (int d = 0; listDut[d] != 0; d++)
+    {
+        dut = listDut[d] - 1;
+        serial = first + d;
+        
+        for (int b = 0; b < this->REG_SN.num_registers; b++)
+            values[(b * TOOL_MAX_DUT) + dut] = (byte)(serial >> (8 * b));
+    }
+    
+    this->SetSN(values, listDut);
+    this->VfySN(values, listDut);
+}
+
+/******************************************************************************
+    Name:   VfySN
+    Desc:   Checks each site has the serial number in values (see GetSN),
+            with one burst read
+******************************************************************************/
+void CDeviceCore::VfySN(int* values, word* listDut)
+{
+    DBGTrace("--> CDeviceCore::VfySN");
+    
+    String msg;
+    int dut;
+    byte sn[APP_MAX_ADDR][TOOL_MAX_DUT];
+    
+    this->GetSpan(this->REG_SN, &sn[0][0], listDut);
+    
+    for (int d = 0; listDut[d] != 0; d++)
+    {
+        dut = listDut[d] - 1;
+        
+        for (int b = 0; b < this->REG_SN.num_registers; b++)
+        {
+            if (sn[b][dut] != (byte)values[(b * TOOL_MAX_DUT) + dut])
+            {
+                sprintf(msg, "Site %i SN byte %i is 0x%02X, expected 0x%02X", dut+1, b, sn[b][dut], (byte)values[(b * TOOL_MAX_DUT) + dut]);
+                ERRChk(ERROR_ASIC_SPECIFIC, msg);
+            }
+        }
+    }
+}
+
+/******************************************************************************
+    Name:   GetSpan
+    Desc:   Reads a multiple address register with one burst from its lowest
+            to its highest address, then picks out its bytes (same layout as
+            GetRegister)
+            NOTE: only for registers with no clear-on-read bytes in between
+******************************************************************************/
+void CDeviceCore::GetSpan(const ASICregister& reg, byte* output, word* listDut)
+{
+    DBGTrace("--> CDeviceCore::GetSpan");
+    
+    byte low = ADDR_INVALID;
+    byte high = 0;
+    byte span[MAX_PAGE_SIZE][TOOL_MAX_DUT];
+    
+    for (int a = 0; a < reg.num_registers; a++)
+    {
+        if (reg.Address(a) != ADDR_INVALID)
+        {
+            low = min(low, reg.Address(a));
+            high = max(high, reg.Address(a));
+        }
+    }
+    
+    if (low == ADDR_INVALID)
+        return;
+    
+    this->GetByte(reg.page, low, (high - low) + 1, &span[0][0], listDut, reg.name);
+    
+    for (int a = 0; a < reg.num_registers; a++)
+    {
+        if (reg.Address(a) != ADDR_INVALID)
+            memcpy(&output[a * TOOL_MAX_DUT], span[reg.Address(a) - low], TOOL_MAX_DUT);
+    }
+    
+    reg.MaskAndShift(output, listDut);
+}
+
+/******************************************************************************
+    Name:   BeginMemoryAccess
+    Desc:   Opens a memory access window: STATE_LOCK_MEMORY_ACCESS is put off
+            until the matching EndMemoryAccess, so back to back ROM
+            operations only unlock the OTP (and wait MEMORY_DELAY) once.
+            Windows can be nested.  GetROM, VerifyROM and GetSnapshot each
+            open one, so a caller chaining them opens one around all of them.
+******************************************************************************/
+void CDeviceCore::BeginMemoryAccess(void)
+{
+    DBGTrace("--> CDeviceCore::BeginMemoryAccess");
+    
+    if (this->MemDepth++ == 0)
+        this->MemSettled = false;
+}
+
+/******************************************************************************
+    Name:   EndMemoryAccess
+    Desc:   Closes a memory access window, locking memory access when the
+            outermost one is closed
+******************************************************************************/
+void CDeviceCore::EndMemoryAccess(word* listDut)
+{
+    DBGTrace("--> CDeviceCore::EndMemoryAccess");
+    
+    if (this->MemDepth == 0)
+    {
+        ERRWarn("EndMemoryAccess without BeginMemoryAccess");
+        return;
+    }
+    
+    if (--this->MemDepth == 0)
+    {
+        this->SetState(STATE_LOCK_MEMORY_ACCESS, listDut);
+        this->MemSettled = false;
+    }
+}
+
+/******************************************************************************
+    Name:   ForgetMemoryAccess
+    Desc:   Marks the OTP memory access mode of each site as unknown (after a
+            reset or a write that may have changed it) so the next OTP state
+            sends the whole key sequence again
+******************************************************************************/
+void CDeviceCore::ForgetMemoryAccess(word* listDut)
+{
+    for (int d = 0; listDut[d] != 0; d++)
+        this->MemAccess[listDut[d] - 1] = STATE_DEVICE_UNKNOWN;
+    
+    this->MemSettled = false;
+}
+
+/******************************************************************************
+    Name:   Changed
+    Desc:   Finds the sites where SetRegister(reg, value) would change what was
+            last written to the part (or where that isn't known), and lists
+            them in changeDut.  Self-clearing bits (see SkipShadow) may have
+            cleared themselves, so setting them is always a change.  Returns
+            the number of sites.
+            NOTE: single byte registers only
+******************************************************************************/
+int CDeviceCore::Changed(const ASICregister& reg, byte value, word* listDut, word* changeDut)
+{
+    int dut;
+    int num = 0;
+    byte pg = WriteLog::Page(reg.page);
+    byte addr = reg.addr[0];
+    byte have[TOOL_MAX_DUT];
+    byte want[TOOL_MAX_DUT];
+    
+    if ( (pg >= NUM_PAGES) || (addr >= MAX_PAGE_SIZE) || (reg.num_registers > 1) )
+    {
+        for (int d = 0; listDut[d] != 0; d++)
+            changeDut[num++] = listDut[d];
+        changeDut[num] = 0;
+        return num;
+    }
+    
+    memcpy(have, this->Shadow[pg][addr], sizeof(have));
+    memset(want, value, sizeof(want));
+    
+    // the byte SetRegister would write
+    if (reg.mask[0] != 0xFF)
+        reg.ShiftAndMask(have, want, listDut);
+    
+    byte selfclear = this->NoShadow[pg][addr] & reg.mask[0];
+    
+    for (int d = 0; listDut[d] != 0; d++)
+    {
+        dut = listDut[d] - 1;
+        
+        if ( (this->Known[pg][addr][dut] != 0xFF) || (want[dut] != have[dut]) ||
+            ((want[dut] & selfclear) != 0) )
+            changeDut[num++] = listDut[d];
+    }
+    changeDut[num] = 0;
+    
+    return num;
+}
+
+/******************************************************************************
+    Name:   SkipRestore
+    Desc:   Leaves the bits of a register out of RestoreVolatile and
+            CompareVolatile.  Called by the unique ASIC for read-only and
+            self-clearing registers (self-clearing bits are written as 0).
+******************************************************************************/
+void CDeviceCore::SkipRestore(const ASICregister& reg)
+{
+    CDeviceBase::MarkBits(reg, this->NoRestore);
+}
+
+/******************************************************************************
+    Name:   SkipShadow
+    Desc:   Marks the bits of a register as self-clearing, so Changed never
+            skips writing them.  Called by the unique ASIC for bits like soft
+            reset that act and clear themselves (only those: keys and modes
+            that read back what was written can still be skipped).
+******************************************************************************/
+void CDeviceCore::SkipShadow(const ASICregister& reg)
+{
+    CDeviceBase::MarkBits(reg, this->NoShadow);
+}
+
+/******************************************************************************
+    Name:   SaveVolatile
+    Desc:   Snapshots the Volatile page(s) with one burst read each, so they
+            can be put back with RestoreVolatile
+******************************************************************************/
+void CDeviceCore::SaveVolatile(word* listDut)
+{
+    DBGTrace("--> CDeviceCore::SaveVolatile");
+    
+    this->GetRegister(this->RawVOLATILE, &this->VolatileImage.Raw[0][0], listDut);
+    
+#if NUM_VOL_PAGES > 1
+    this->GetRegister(this->RawVOLATILE_2, &this->VolatileImage_2.Raw[0][0], listDut);
+#endif
+    
+    this->SavedSites = 0;
+    for (int d = 0; listDut[d] != 0; d++)
+        this->SavedSites |= (1 << (listDut[d] - 1));
+}
+
+/******************************************************************************
+    Name:   RestoreVolatile
+    Desc:   Puts the Volatile page(s) back to what SaveVolatile read.  Only
+            the bytes and sites that changed are written, in bursts of
+            consecutive bytes.  Returns the number of bytes written.
+******************************************************************************/
+int CDeviceCore::RestoreVolatile(word* listDut)
+{
+    DBGTrace("--> CDeviceCore::RestoreVolatile");
+    
+    int written = this->RestorePage(this->VolatileImage, this->RawVOLATILE, listDut);
+    
+#if NUM_VOL_PAGES > 1
+    written += this->RestorePage(this->VolatileImage_2, this->RawVOLATILE_2, listDut);
+#endif
+    
+    // the memory access keys and MR may have been written (unless the ASIC
+    // leaves them out, see SkipRestore)
+    if (written > 0)
+        this->ForgetMemoryAccess(listDut);
+    
+    return written;
+}
+
+/******************************************************************************
+    Name:   CompareVolatile
+    Desc:   Checks the Volatile page(s) still match what SaveVolatile read
+            (read-only and self-clearing bits are ignored).  Only the sites
+            SaveVolatile read are compared; any other site fails.  Returns
+            true if every site matches.
+******************************************************************************/
+bool CDeviceCore::CompareVolatile(word* listDut)
+{
+    DBGTrace("--> CDeviceCore::CompareVolatile");
+    
+    word savedDut[TOOL_MAX_DUT + 1];
+    word sites = 0;
+    for (int d = 0; listDut[d] != 0; d++)
+        sites |= (1 << (listDut[d] - 1));
+    
+    if ((sites & ~this->SavedSites) != 0)
+        ERRWarn("CompareVolatile: some sites were not saved by SaveVolatile");
+    
+    if (this->SiteList(sites & this->SavedSites, listDut, savedDut) == 0)
+        return false;
+    
+    word pass = this->ComparePage(this->VolatileImage, this->RawVOLATILE, savedDut);
+    
+#if NUM_VOL_PAGES > 1
+    pass &= this->ComparePage(this->VolatileImage_2, this->RawVOLATILE_2, savedDut);
+#endif
+    
+    return ((pass & sites) == sites);
+}
+
+/******************************************************************************
+    Name:   GetSnapshot
+    Desc:   Captures Volatile, RAM, and ROM for all sites as one planned
+            sequence of burst reads.  Volatile is read first (before the OTP
+            read mode changes it), the read mode is set while still on the
+            Volatile page, and then RAM and ROM are read, so the page only
+            changes once per memory.
+******************************************************************************/
+void CDeviceCore::GetSnapshot(DeviceSnapshot* snap, word* listDut)
+{
+    DBGTrace("--> CDeviceCore::GetSnapshot");
+    
+    snap->Clear();
+    
+    // Volatile
+    this->GetRegister(this->RawVOLATILE, &snap->Volatile[0][0], listDut);
+#if NUM_VOL_PAGES > 1
+    this->GetRegister(this->RawVOLATILE_2, &snap->Volatile_2[0][0], listDut);
+#endif
+    
+#if defined(_OTP_) && !defined(_LV_COMM_)
+    // put the parts into redundant read mode (Volatile page)
+    this->BeginMemoryAccess();
     this->SetState(STATE_REDUNDANT_READ_MODE, listDut);
+#endif
+    
+    // RAM
+    this->GetRegister(this->RawRAM, &snap->RAM[0][0], listDut);
+    
+#if defined(_OTP_) && !defined(_LV_COMM_)
+    // ROM
+    this->GetRegister(this->RawROM, &snap->ROM[0][0], listDut);
+    
+    // lock memory access (unless the caller has a window open)
+    this->EndMemoryAccess(listDut);
+#endif
+    
+    for (int d = 0; listDut[d] != 0; d++)
+        snap->sites |= (1 << (listDut[d] - 1));
+}
+
+/******************************************************************************
+    Name:   CompareSnapshot
+    Desc:   Diffs two snapshots (diff may be NULL), ignoring the read-only and
+            self-clearing Volatile bits (see SkipRestore).  Returns the sites
+            that match.
+******************************************************************************/
+word CDeviceCore::CompareSnapshot(const DeviceSnapshot& snap, const DeviceSnapshot& other, DeviceSnapshot* diff, word* listDut)
+{
+    DBGTrace("--> CDeviceCore::CompareSnapshot");
+    
+    byte page = (VOL_PG1 == PAGE_INVALID) ? 0 : VOL_PG1;
+    byte keep[NUM_VOL_REG];
+    
+    for (int i = 0; i < NUM_VOL_REG; i++)
+        keep[i] = ~this->NoRestore[page][i];
+    
+    return snap.Diff(other, diff, listDut, keep);
+}
+
+/******************************************************************************
+    Name:   RestorePage
+    Desc:   Reads the page in one burst and writes back the saved value for
+            every run of consecutive bytes that differ (to the sites that
+            differ in that run).  Settings are ignored while PC1 = 1, so if
+            the page holds PC1 it is cleared before anything else is
+            written, and its byte is written back last.  Returns the number
+            of bytes written.
+******************************************************************************/
+int CDeviceCore::RestorePage(const VolImage& saved, const ASICregister& raw, word* listDut)
+{
+    DBGTrace("--> CDeviceCore::RestorePage");
+    
+    int dut, start;
+    int written = 0;
+    int count = min(saved.count, (int)MAX_PAGE_SIZE);
+    byte page = (saved.page == PAGE_INVALID) ? 0 : saved.page;
+    const byte* skip = &this->NoRestore[page][0];
+    word differs[MAX_PAGE_SIZE];
+    word runDut[TOOL_MAX_DUT + 1];
+    word anySites = 0;
+    int pc = -1;
+    byte pcMask = this->REG_PC1.mask[0];
+    VolImage current = VolImage(saved.page, saved.count);
+    
+    // only sites that were saved
+    word sites = 0;
+    for (int d = 0; listDut[d] != 0; d++)
+        sites |= (1 << (listDut[d] - 1));
+    sites &= this->SavedSites;
+    
+    this->GetRegister(raw, &current.Raw[0][0], listDut);
+    
+    // sites that differ for each byte
+    for (int i = 0; i < count; i++)
+    {
+        byte keep = ~skip[i];
+        word bad = 0;
+        
+        for (dut = 0; dut < TOOL_MAX_DUT; dut++)
+            bad |= (word)((((current.Raw[i][dut] ^ saved.Raw[i][dut]) & keep) != 0) << dut);
+        
+        differs[i] = bad & sites;
+        anySites |= differs[i];
+    }
+    
+    // the byte holding PC1, if it is on this page
+    if ( (WriteLog::Page(this->REG_PC1.page) == page) && (this->REG_PC1.addr[0] >= raw.addr[0]) &&
+        (this->REG_PC1.addr[0] - raw.addr[0] < count) )
+        pc = this->REG_PC1.addr[0] - raw.addr[0];
+    
+    // standby first (what the part has now, with PC1 cleared)
+    if ( (pc >= 0) && (this->SiteList(anySites, listDut, runDut) > 0) )
+    {
+        for (dut = 0; dut < TOOL_MAX_DUT; dut++)
+            current.Raw[pc][dut] &= ~pcMask;
+        
+        this->SetByte(raw.page, (byte)(raw.addr[0] + pc), &current.Raw[pc][0], runDut, "restore");
+        written++;
+        differs[pc] = 0;
+    }
+    
+    // write each run of consecutive bytes that differ
+    for (int i = 0; i < count; i++)
+    {
+        if (differs[i] == 0)
+            continue;
+        
+        start = i;
+        word runSites = differs[i];
+        while ( (i + 1 < count) && (differs[i + 1] != 0) )
+            runSites |= differs[++i];
+        
+        this->SiteList(runSites, listDut, runDut);
+        
+        // self-clearing bits go back as 0
+        for (int a = start; a <= i; a++)
+        {
+            for (dut = 0; dut < TOOL_MAX_DUT; dut++)
+                current.Raw[a][dut] = saved.Raw[a][dut] & ~skip[a];
+        }
+        
+        this->SetByte(raw.page, (byte)(raw.addr[0] + start), (i - start) + 1, &current.Raw[start][0], runDut, "restore");
+        written += (i - start) + 1;
+    }
+    
+    // then the saved operating mode
+    if ( (pc >= 0) && (this->SiteList(anySites, listDut, runDut) > 0) )
+    {
+        for (dut = 0; dut < TOOL_MAX_DUT; dut++)
+            current.Raw[pc][dut] = saved.Raw[pc][dut] & ~skip[pc];
+        
+        this->SetByte(raw.page, (byte)(raw.addr[0] + pc), &current.Raw[pc][0], runDut, "restore");
+        written++;
+    }
+    
+    return written;
+}
+
+/******************************************************************************
+    Name:   SiteList
+    Desc:   Lists the sites of listDut in the sites bit mask (bit per DUT) in
+            siteDut, returns how many
+******************************************************************************/
+int CDeviceCore::SiteList(word sites, word* listDut, word* siteDut)
+{
+    int n = 0;
+    
+    for (int d = 0; listDut[d] != 0; d++)
+    {
+        if ((sites >> (listDut[d] - 1)) & 1)
+            siteDut[n++] = listDut[d];
+    }
+    siteDut[n] = 0;
+    
+    return n;
+}
+
+/******************************************************************************
+    Name:   ComparePage
+    Desc:   Reads the page in one burst and compares it against the saved
+            image (read-only and self-clearing bits are ignored).  Returns
+            the sites that match.
+******************************************************************************/
+word CDeviceCore::ComparePage(const VolImage& saved, const ASICregister& raw, word* listDut)
+{
+    DBGTrace("--> CDeviceCore::ComparePage");
+    
+    int count = min(saved.count, (int)MAX_PAGE_SIZE);
+    byte page = (saved.page == PAGE_INVALID) ? 0 : saved.page;
+    byte keep[MAX_PAGE_SIZE];
+    byte diff[MAX_PAGE_SIZE][TOOL_MAX_DUT];
+    VolImage current = VolImage(saved.page, saved.count);
+    
+    this->GetRegister(raw, &current.Raw[0][0], listDut);
+    
+    for (int i = 0; i < count; i++)
+        keep[i] = ~this->NoRestore[page][i];
+    
+    word pass = ImageCompare::Diff(&current.Raw[0][0], &saved.Raw[0][0], keep, count, &diff[0][0], listDut);
+    
+    if (DBGVerboseEnabled)
+    {
+        String header;
+        sprintf(header, "\nVolatileImage diff saved page %i", page);
+        ImageCompare::Report(&diff[0][0], count, pass, header, listDut);
+    }
     
-    // lock memory access
-    this->SetState(STATE_LOCK_MEMORY_ACCESS, listDut);
+    return pass;
 }
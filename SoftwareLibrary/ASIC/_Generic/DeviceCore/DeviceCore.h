@@ -26,11 +26,45 @@ protected:
     byte comm_types;
     int CurrState;
     
+    // bits left out of RestoreVolatile/CompareVolatile (read-only and
+    // self-clearing registers), and the sites saved by SaveVolatile
+    byte NoRestore[NUM_PAGES][MAX_PAGE_SIZE];
+    word SavedSites;
+    
+    // self-clearing bits (soft reset, command test), which the shadow can't
+    // follow once they clear, so writing them is always a change
+    byte NoShadow[NUM_PAGES][MAX_PAGE_SIZE];
+    
+    // OTP memory access mode of each site (the last OTP state set, or
+    // STATE_DEVICE_UNKNOWN if it has to be set again), and how many
+    // BeginMemoryAccess windows are open (locking waits for the last one),
+    // and if MEMORY_DELAY was already paid in this window
+    int MemAccess[TOOL_MAX_DUT];
+    int MemDepth;
+    bool MemSettled;
+    
+    // unique serial numbers for AssignSN
+    CSerialPool SerialPool;
+    
+    void ForgetMemoryAccess(word* listDut);
     void TestModeEnable(word* listDut);
+    void SkipRestore(const ASICregister& reg);
+    void SkipShadow(const ASICregister& reg);
+    int Changed(const ASICregister& reg, byte value, word* listDut, word* changeDut);
 
 private:
     void Setlsb(byte slave_addr, word* listDut);
-    void Burn(byte reg_loc, int num_registers, word* listDut);
+#ifdef _OTP_BURN_
+    void Burn(byte reg_loc, int num_registers, byte* bits, word* listDut);
+    int BurnRuns(byte* bits, word* listDut);
+#endif
+    void BankSelect(byte select[MAX_NUM_BANKS][TOOL_MAX_DUT], word* listDut);
+    void SelectBank(byte* select, word* listDut);
+    void CaptureBanks(word* listDut);
+    int RestorePage(const VolImage& saved, const ASICregister& raw, word* listDut);
+    int SiteList(word sites, word* listDut, word* siteDut);
+    word ComparePage(const VolImage& saved, const ASICregister& raw, word* listDut);
+    void GetSpan(const ASICregister& reg, byte* output, word* listDut);
 
 public:
     ~CDeviceCore(void);
@@ -59,15 +93,26 @@ public:
     void GetROM(byte* values, word* listDut);
     void SetROM(int* values, word* listDut);
     void VerifyROM(int burned, bool* result, byte* difference, word* listDut);
+#ifdef _OTP_BURN_
+    int ProgramROM(byte* target, bool* result, word* listDut);
+#endif
+    
+    // keep OTP memory access unlocked across several ROM operations
+    void BeginMemoryAccess(void);
+    void EndMemoryAccess(word* listDut);
     
     void GetSN(int* values, word* listDut);
     void SetSN(int* values, word* listDut);
+    void AssignSN(int* values, word* listDut);
     void VfySN(int* values, word* listDut);
     
-    void SaveVolatile(void);
-    void RestoreVolatile(void);
+    void SaveVolatile(word* listDut);
+    int RestoreVolatile(word* listDut);
     bool CompareVolatile(word* listDut);
     
+    void GetSnapshot(DeviceSnapshot* snap, word* listDut);
+    word CompareSnapshot(const DeviceSnapshot& snap, const DeviceSnapshot& other, DeviceSnapshot* diff, word* listDut);
+    
     void GetRegulator(int* codes, word* listDut);
     void SetRegulator(int* codes, word* listDut);
     void MeasRegulator(double* values, word* listDut);
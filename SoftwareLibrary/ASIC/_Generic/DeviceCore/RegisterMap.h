@@ -79,6 +79,10 @@ protected:
                                        single-ended read mode                */
     byte REDUNDANT;                 /* value to change the OTP into to
                                        redundant read mode                   */
+#ifdef _OTP_BURN_
+    byte BURN;                      /* value to change the OTP into to burn
+                                       mode                                  */
+#endif
 #elif defined(_EEPROM_)
     ASICregister REG_PRG_EN;        /* enable writing to non-volatile memory */
     ASICregister REG_NVM_EN;        /* non-volatile memory burn controls     */
@@ -10,32 +10,42 @@
 
 #include "Defines.h"
 
+//-----------------------------------------------------------------------------
+// register IDs (index into a RegisterTable)
+typedef word regid;
+#define REGID_INVALID                   0xFFFF
+
 //-----------------------------------------------------------------------------
 // conversion types
 typedef struct convert_type
 {
     contype type;
-    string name;
     
-    convert_type(void) {}
+    convert_type(void) : type(MAX_CONTYPE) {}
     
-    convert_type(contype type_in) : type(type_in)
-    {
-        string names[MAX_CONTYPE];
-        SetNames(names);
-        name = names[type_in];
-    }
+    convert_type(contype type_in) : type(type_in) {}
     
-    void SetNames(string *names)
+    // name for messages (looked up, so the struct carries no string)
+    const char* Name(void) const { return Name(type); }
+    
+    // names are indexed by contype, so keep them in the same order as the enum
+    static const char* Name(contype type_in)
     {
-        names[convert_bit] = STR(bit);
-        names[convert_byte] = STR(byte);
-        names[convert_uint] = STR(unsigned int);
-        names[convert_SN] = STR(serial number);
-        names[twos_comp] = "two's compliment";
-        names[twos_comp_invert_neg] = "two's compliment with negatives inverted";
-        names[twos_comp_invert_pos] = "two's compliment with positives inverted";
-        names[sense_output] = STR(sense element output);
+        if ( (type_in < 0) || (type_in >= MAX_CONTYPE) )
+            return "";
+        
+        static const char* names[MAX_CONTYPE] = {
+            STR(bit),
+            STR(byte),
+            STR(unsigned int),
+            STR(serial number),
+            "two's compliment",
+            "two's compliment with negatives inverted",
+            "two's compliment with positives inverted",
+            STR(sense element output)
+        };
+        
+        return names[type_in];
     }
     
     bool operator==(const convert_type& c) const
@@ -49,22 +59,27 @@ typedef struct convert_type
 typedef struct memory_type
 {
     mtype type;
-    string name;
     
-    memory_type(void) {}
+    memory_type(void) : type((mtype)(ROM + 1)) {}
     
-    memory_type(mtype type_in) : type(type_in)
-    {
-        string names[ROM + 1];
-        SetNames(names);
-        name = names[type_in];
-    }
+    memory_type(mtype type_in) : type(type_in) {}
+    
+    // name for messages (looked up, so the struct carries no string)
+    const char* Name(void) const { return Name(type); }
     
-    void SetNames(string *names)
-    { 
-        names[Volatile] = STR(Volatile);
-        names[RAM] = STR(RAM);
-        names[ROM] = STR(ROM);
+    // names are indexed by mtype, so keep them in the same order as the enum
+    static const char* Name(mtype type_in)
+    {
+        if ( (type_in < 0) || (type_in > ROM) )
+            return "";
+        
+        static const char* names[ROM + 1] = {
+            STR(Volatile),
+            STR(RAM),
+            STR(ROM)
+        };
+        
+        return names[type_in];
     }
     
     bool operator!=(const memory_type& m) const
@@ -78,11 +93,220 @@ typedef struct memory_type
     }
 } memory_type;
 
+//-----------------------------------------------------------------------------
+//  site conversions
+//  One specialization per conversion-type converts a whole row of sites
+//  (TOOL_MAX_DUT combined register values) with no branches in the loop, so
+//  the type is only looked at once per register instead of once per DUT.
+template <contype TYPE>
+struct SiteConvert
+{
+    // bit, byte, and uint: combined value is the int
+    static void ToInt(const int* total, int* out, int, int)
+    {
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+            out[dut] = total[dut];
+    }
+    
+    static void FromInt(const int* in, int* total, int, int)
+    {
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+            total[dut] = in[dut];
+    }
+};
+
+template <>
+struct SiteConvert<twos_comp>
+{
+    static void ToInt(const int* total, int* out, int midpoint, int max_value)
+    {
+        // subtract max when above midpoint (sign mask is 0 or -1)
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+            out[dut] = total[dut] - (max_value & -(int)(total[dut] > midpoint));
+    }
+    
+    static void FromInt(const int* in, int* total, int, int max_value)
+    {
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+            total[dut] = in[dut] + (max_value & -(int)(in[dut] < 0));
+    }
+};
+
+template <>
+struct SiteConvert<twos_comp_invert_neg>
+{
+    static void ToInt(const int* total, int* out, int midpoint, int)
+    {
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+        {
+            // Nathan's weird shift (midpoint maps to midpoint - 1)
+            int t = total[dut] - (int)(total[dut] == midpoint);
+            
+            // Nathan's two's compliment
+            int below = -(int)(t < midpoint);
+            out[dut] = ((t + 1) & below) | (((midpoint + 1) - t) & ~below);
+        }
+    }
+    
+    static void FromInt(const int* in, int* total, int midpoint, int)
+    {
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+        {
+            int positive = -(int)(in[dut] > 0);
+            total[dut] = ((in[dut] - 1) & positive) | (((midpoint + 1) - in[dut]) & ~positive);
+        }
+    }
+};
+
+template <>
+struct SiteConvert<sense_output>
+{
+    static void ToInt(const int* total, int* out, int midpoint, int max_value)
+    {
+#ifdef _UNSIGNED_OUTPUTS_
+        // subtract the mid for unsigned outputs
+        int offset = midpoint;
+#else
+        int offset = 0;
+#endif
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+            out[dut] = total[dut] - (max_value & -(int)(total[dut] > midpoint)) - offset;
+    }
+};
+
+// picks the specialization (once per register), returns false if the
+// conversion-type can not be converted
+struct SiteConverter
+{
+    static bool ToInt(contype type, const int* total, int* out, int midpoint, int max_value)
+    {
+        switch (type)
+        {
+        case convert_bit:
+        case convert_byte:
+        case convert_uint:
+            SiteConvert<convert_uint>::ToInt(total, out, midpoint, max_value);
+            return true;
+        case twos_comp:
+            SiteConvert<twos_comp>::ToInt(total, out, midpoint, max_value);
+            return true;
+        case twos_comp_invert_neg:
+            SiteConvert<twos_comp_invert_neg>::ToInt(total, out, midpoint, max_value);
+            return true;
+        case sense_output:
+            SiteConvert<sense_output>::ToInt(total, out, midpoint, max_value);
+            return true;
+        default:
+            return false;
+        }
+    }
+    
+    static bool FromInt(contype type, const int* in, int* total, int midpoint, int max_value)
+    {
+        switch (type)
+        {
+        case convert_bit:
+        case convert_byte:
+        case convert_uint:
+            SiteConvert<convert_uint>::FromInt(in, total, midpoint, max_value);
+            return true;
+        case twos_comp:
+            SiteConvert<twos_comp>::FromInt(in, total, midpoint, max_value);
+            return true;
+        case twos_comp_invert_neg:
+            SiteConvert<twos_comp_invert_neg>::FromInt(in, total, midpoint, max_value);
+            return true;
+        default:
+            return false;
+        }
+    }
+};
+
+//-----------------------------------------------------------------------------
+//  compile-time register definitions
+//  Lets an ASIC define its register map as a constant table: shift and
+//  bitcount are calculated by the compiler and a NULL mask fails the build.
+template <unsigned int MASK, bool LSB_SET = ((MASK & 1) != 0)>
+struct MaskShift { enum { value = 1 + MaskShift<(MASK >> 1)>::value }; };
+template <unsigned int MASK>
+struct MaskShift<MASK, true> { enum { value = 0 }; };
+template <>
+struct MaskShift<0, false> { enum { value = 0 }; };
+
+template <unsigned int MASK>
+struct MaskBits { enum { value = (MASK & 1) + MaskBits<(MASK >> 1)>::value }; };
+template <>
+struct MaskBits<0> { enum { value = 0 }; };
+
+template <unsigned int MASK>
+struct NonNullMask { enum { value = MASK }; };
+template <>
+struct NonNullMask<0>;              // not defined: NULL mask will not compile
+
+typedef struct RegisterDef
+{
+    const char*     name;
+    byte            page;
+    byte            addr[APP_MAX_ADDR];
+    byte            mask[APP_MAX_ADDR];
+    byte            shift[APP_MAX_ADDR];
+    byte            bitcount[APP_MAX_ADDR];
+    contype         conversion;
+    mtype           memory;
+    byte            num_registers;
+    byte            lsb;
+    byte            msb;
+} RegisterDef;
+
+// the RegisterDef initializers below are written out for 6 addresses
+STATIC_CHECK(APP_MAX_ADDR == 6, RegisterDef_initializers_need_APP_MAX_ADDR_entries);
+
+// same rules as the single address ASICregister constructor
+#define REGDEF_BITS(mask, conv, num) \
+    ((((num) == 1) && ((mask) == 0xFF)) ? 8 : \
+        (((conv) == convert_bit) ? 1 : MaskBits<(mask)>::value))
+#define REGDEF_NEXT_BITS(a, mask, conv, num) \
+    ((((a) < (num)) && ((num) <= APP_MAX_ADDR) && ((conv) != convert_bit)) ? \
+        MaskBits<(mask)>::value : 0)
+
+// single byte, bits within a byte, or consecutive bytes (mask = 0xFF)
+#define REGISTER_DEF(name, page, addr, mask, conv, mem, num) \
+    { name, page, \
+      { addr, ADDR_INVALID, ADDR_INVALID, ADDR_INVALID, ADDR_INVALID, ADDR_INVALID }, \
+      { NonNullMask<(mask)>::value, 0, 0, 0, 0, 0 }, \
+      { MaskShift<(mask)>::value, 0, 0, 0, 0, 0 }, \
+      { REGDEF_BITS(mask, conv, num), REGDEF_NEXT_BITS(1, mask, conv, num), \
+        REGDEF_NEXT_BITS(2, mask, conv, num), REGDEF_NEXT_BITS(3, mask, conv, num), \
+        REGDEF_NEXT_BITS(4, mask, conv, num), REGDEF_NEXT_BITS(5, mask, conv, num) }, \
+      conv, mem, num, ADDR_INVALID, ADDR_INVALID }
+
+// one entry of a register with multiple addrs and masks
+#define REGDEF_ADDR(a, addr, num)   (((a) < (num)) ? (addr) : ADDR_INVALID)
+#define REGDEF_MASK(a, mask, num)   (((a) < (num)) ? (mask) : 0x00)
+#define REGDEF_SHIFT(a, mask, num)  (((a) < (num)) ? MaskShift<(mask)>::value : 0)
+#define REGDEF_COUNT(a, mask, num)  (((a) < (num)) ? MaskBits<(mask)>::value : 0)
+
+// multiple addrs and masks (set lsb and msb to ADDR_INVALID if not used)
+#define REGISTER_DEF_ARRAY(name, page, a0, a1, a2, a3, a4, a5, \
+        m0, m1, m2, m3, m4, m5, conv, mem, num, lsb, msb) \
+    { name, page, \
+      { REGDEF_ADDR(0, a0, num), REGDEF_ADDR(1, a1, num), REGDEF_ADDR(2, a2, num), \
+        REGDEF_ADDR(3, a3, num), REGDEF_ADDR(4, a4, num), REGDEF_ADDR(5, a5, num) }, \
+      { NonNullMask<(m0)>::value, REGDEF_MASK(1, m1, num), REGDEF_MASK(2, m2, num), \
+        REGDEF_MASK(3, m3, num), REGDEF_MASK(4, m4, num), REGDEF_MASK(5, m5, num) }, \
+      { REGDEF_SHIFT(0, m0, num), REGDEF_SHIFT(1, m1, num), REGDEF_SHIFT(2, m2, num), \
+        REGDEF_SHIFT(3, m3, num), REGDEF_SHIFT(4, m4, num), REGDEF_SHIFT(5, m5, num) }, \
+      { REGDEF_COUNT(0, m0, num), REGDEF_COUNT(1, m1, num), REGDEF_COUNT(2, m2, num), \
+        REGDEF_COUNT(3, m3, num), REGDEF_COUNT(4, m4, num), REGDEF_COUNT(5, m5, num) }, \
+      conv, mem, num, lsb, msb }
+
 //-----------------------------------------------------------------------------
 //  register struct
+//  The fields used on every access come first; the name, only used in
+//  messages, is last.
 typedef struct ASICregister
 {
-    string          name;                   // for use in debug
+    regid           id;                     // index into RegisterTable
     byte            page;                   // all addr in reg are on same page
     byte            addr[APP_MAX_ADDR];     // can have multiple addresses
     byte            mask[APP_MAX_ADDR];     // each addr has a mask
@@ -93,9 +317,10 @@ typedef struct ASICregister
     byte            num_registers;          // total bytes in reg
     byte            lsb;                    // least significant bit addr index
     byte            msb;                    // same style as lsb
+    const char*     name;                   // for use in debug (static string)
     
     // default contructor (empty)
-    ASICregister(void)
+    ASICregister(void) : id(REGID_INVALID), page(PAGE_INVALID), num_registers(0), name("")
     {
         memset(addr, ADDR_INVALID, sizeof(addr));
         memset(mask, NULL, sizeof(mask));
@@ -105,13 +330,24 @@ typedef struct ASICregister
         msb = ADDR_INVALID;
     }
     
+    // construct from a compile-time definition (nothing left to calculate)
+    ASICregister(const RegisterDef& def)
+        : id(REGID_INVALID), page(def.page), conversion(def.conversion), memory(def.memory),
+        num_registers(def.num_registers), lsb(def.lsb), msb(def.msb), name(def.name)
+    {
+        memcpy(addr, def.addr, sizeof(addr));
+        memcpy(mask, def.mask, sizeof(mask));
+        memcpy(shift, def.shift, sizeof(shift));
+        memcpy(bitcount, def.bitcount, sizeof(bitcount));
+    }
+    
     // construct with single addr and mask
     // NOTE: for a single byte OR multiple consecutive registers
     // for multiple, set num_in to total, addr_in to starting address, and mask to 0xFF
-    ASICregister(String name_in, byte page_in, byte addr_in, byte mask_in,
+    ASICregister(const char* name_in, byte page_in, byte addr_in, byte mask_in,
         convert_type conv_in, memory_type mem_in, int num_in)
-        : name(name_in), page(page_in), conversion(conv_in), memory(mem_in),
-        num_registers(num_in)
+        : id(REGID_INVALID), page(page_in), conversion(conv_in), memory(mem_in),
+        num_registers(num_in), name(name_in)
     {
         memset(addr, ADDR_INVALID, sizeof(addr));
         memset(mask, NULL, sizeof(mask));
@@ -168,10 +404,10 @@ typedef struct ASICregister
     
     // construct with multiple addrs and masks
     // NOTE: num_in is *intended* to be the total bytes or conversion will not work
-    ASICregister(String name_in, byte page_in, byte* addr_in, byte* mask_in,
+    ASICregister(const char* name_in, byte page_in, byte* addr_in, byte* mask_in,
         convert_type conv_in, memory_type mem_in, int num_in)
-        : name(name_in), page(page_in), conversion(conv_in), memory(mem_in),
-        num_registers(num_in)
+        : id(REGID_INVALID), page(page_in), conversion(conv_in), memory(mem_in),
+        num_registers(num_in), name(name_in)
     {
         memset(addr, ADDR_INVALID, sizeof(addr));
         memset(mask, NULL, sizeof(mask));
@@ -212,10 +448,10 @@ typedef struct ASICregister
     // construct with multiple addrs and masks, including a lsb and msb
     // NOTE: This is *intended* to be used for cases with > 1 byte for a single
     // value, but currently only supports 2 bytes total (see Convert functions)
-    ASICregister(String name_in, byte page_in, byte* addr_in, byte* mask_in,
+    ASICregister(const char* name_in, byte page_in, byte* addr_in, byte* mask_in,
         convert_type conv_in, memory_type mem_in, int lsb_in, int msb_in)
-        : name(name_in), page(page_in), conversion(conv_in), memory(mem_in),
-        lsb(lsb_in), msb(msb_in)
+        : id(REGID_INVALID), page(page_in), conversion(conv_in), memory(mem_in),
+        lsb(lsb_in), msb(msb_in), name(name_in)
     {
         memset(addr, ADDR_INVALID, sizeof(addr));
         memset(mask, NULL, sizeof(mask));
@@ -267,7 +503,7 @@ typedef struct ASICregister
     
     // Obtain the actual value of the register by masking out unwanted bits and
     // shifting the value to the bottom of the byte(s)
-    void MaskAndShift(byte* output, word* listDut)
+    void MaskAndShift(byte* output, word* listDut) const
     {
         if (DBGVerify >= ENG_LEVEL_3)
             DBGPrint("MaskAndShift");
@@ -318,7 +554,7 @@ typedef struct ASICregister
     
     // Restore the raw value of the register by masking out changes to bits that are
     // not supposed to change and shifting the value back to it's original byte(s)
-    void ShiftAndMask(byte* original, byte* input, word* listDut)
+    void ShiftAndMask(byte* original, byte* input, word* listDut) const
     {
         if (DBGVerify >= ENG_LEVEL_3)
             DBGPrint("ShiftAndMask");
@@ -389,265 +625,281 @@ typedef struct ASICregister
         }
     }
     
-    // convert byte values from register into ints
-    void ConvertToInt(byte* values, int* output, word* listDut)
+    // check the number of bytes works with the conversion-type
+    bool CheckSetup(bool to_int, char* caller) const
     {
-        int dut, index;
-        int temp = 0;
-        int midpoint = 0;
-        int max = 0;
-        word total;
         String msg;
         bool wrong_setup = false;
         
-        for (int d = 0; listDut[d] != 0; d++)
+        switch(conversion.type)
         {
-            dut = listDut[d] - 1;
-            index = ((0 * TOOL_MAX_DUT) + dut);
+        case convert_bit:
+        case convert_byte:
+            wrong_setup = (num_registers > 1);
+            break;
+            
+        case convert_uint:
+        case twos_comp:
+        case twos_comp_invert_neg:
+            wrong_setup = ((num_registers != 1) && (num_registers != 2));
+            break;
             
-            switch(conversion.type)
+        case sense_output:
+            if (!to_int)
             {
-            case convert_bit:
-            case convert_byte:
-                temp = (int)(values[index]);
-                
-                if (num_registers > 1)
-                    wrong_setup = true;
-                
-                break;
-                
-            case convert_uint:
-                if (num_registers == 1)
-                    temp = (int)(values[index]);
-                else if (num_registers == 2)
-                {
-                    // combine 2 bytes
-                    total = CombineBytes(values, dut);
-                    
-                    // cast as int
-                    temp = (int)total;
-                }
-                else
-                    wrong_setup = true;
-                
-                break;
-                
-            case convert_SN:
-                sprintf(msg, "ASICregister currently doesn't support %s", conversion.name.c_str());
-                ERRChk(ERROR_UNIMPLEMENTED, msg);
-                
-                // TODO: decide on implementation of this
-                
-                break;
-                
-            case twos_comp:
-                BitCalcs(&midpoint, &max);
-                
-                if (num_registers == 1)
-                    total = (word)values[index];
-                else if (num_registers == 2)
-                    total = CombineBytes(values, dut);
-                else
-                {
-                    wrong_setup = true;
-                    break;
-                }
-                
-                // two's compliment and cast as int
-                temp = (int)( (total <= midpoint) ? total : (total - max) );
-                
-                break;
-                
-            case twos_comp_invert_neg:
-                BitCalcs(&midpoint, &max);
-                
-                if (num_registers == 1)
-                    total = (word)values[index];
-                else if (num_registers == 2)
-                    total = CombineBytes(values, dut);
-                else
-                {
-                    wrong_setup = true;
-                    break;
-                }
-                
-                // Nathan's weird shift
-                total = ( (total == midpoint) ? (total - 1) : total );
-                
-                // Nathan's two's compliment and cast as int
-                temp = (int)( (total < midpoint) ? (total + 1) : ((midpoint + 1) - total) );
-                
-                break;
-                
-            case twos_comp_invert_pos:
-                sprintf(msg, "ASICregister currently doesn't support %s", conversion.name.c_str());
-                ERRChk(ERROR_UNIMPLEMENTED, msg);
-                break;
+                sprintf(msg, "You should never try to set a register of %s", conversion.Name());
+                ERRChk(ERROR_UNDEFINED, msg, caller, YES);
+                return false;
+            }
+            wrong_setup = (num_registers != 2);
+            break;
+            
+        case convert_SN:
+        case twos_comp_invert_pos:
+            // TODO: decide on implementation of these
+            sprintf(msg, "ASICregister currently doesn't support %s", conversion.Name());
+            ERRChk(ERROR_UNIMPLEMENTED, msg);
+            return false;
+            
+        default:
+            ERRChk(ERROR_UNDEFINED, "No such conversion-type exists.", caller, YES);
+            return false;
+        }
+        
+        if (wrong_setup)
+        {
+            sprintf(msg, "ASICregister %s is incorrectly setup with %i bytes and %s", name, num_registers, conversion.Name());
+            ERRChk(ERROR_ASIC_SPECIFIC, msg, caller, YES);
+            return false;
+        }
+        
+        return true;
+    }
+    
+    // convert byte values from register into ints
+    void ConvertToInt(byte* values, int* output, word* listDut) const
+    {
+        int dut, midpoint, max;
+        int total[TOOL_MAX_DUT];
+        int converted[TOOL_MAX_DUT];
+        
+        memset(converted, 0, sizeof(converted));
+        
+        if (CheckSetup(true, "ASICregister.ConvertToInt"))
+        {
+            // combine bytes for every site
+            if (num_registers == 2)
+            {
+                CombineRows(values, total);
                 
-            case sense_output:
-                if (num_registers == 2)
-                    total = CombineBytes(values, dut);
-                else
+                // show the combine for each DUT
+                if (DBGVerify >= ENG_LEVEL_3)
                 {
-                    wrong_setup = true;
-                    break;
+                    for (int d = 0; listDut[d] != 0; d++)
+                        CombineBytes(values, listDut[d] - 1);
                 }
-                
-                BitCalcs(&midpoint, &max);
-                
-                // two's comp
-                temp = (int)( (total <= midpoint) ? total : (total - max) );
-                
-#ifdef _UNSIGNED_OUTPUTS_
-                // subtract the mid for unsigned outputs
-                temp -= midpoint;
-#endif
-                break;
-                
-            default:
-                ERRChk(ERROR_UNDEFINED, "No such conversion-type exists.", "ASICregister.ConvertToInt", YES);
-                break;
             }
-            
-            if (wrong_setup)
+            else
             {
-                sprintf(msg, "ASICregister %s is incorrectly setup with %i bytes and %s", name, num_registers, conversion.name.c_str());
-                ERRChk(ERROR_ASIC_SPECIFIC, msg, "ASICregister.ConvertToInt", YES);
+                for (dut = 0; dut < TOOL_MAX_DUT; dut++)
+                    total[dut] = values[dut];
             }
             
-            output[index] = temp;
+            BitCalcs(&midpoint, &max);
+            SiteConverter::ToInt(conversion.type, total, converted, midpoint, max);
+        }
+        
+        for (int d = 0; listDut[d] != 0; d++)
+        {
+            dut = listDut[d] - 1;
+            output[dut] = converted[dut];
         }
     }
     
     // convert int values to set to a register into bytes
-    void ConvertFromInt(int* values, byte* output, word* listDut)
+    void ConvertFromInt(int* values, byte* output, word* listDut) const
     {
-        int dut, index, midpoint, max, toconvert;
-        byte temp[APP_MAX_ADDR];
-        String msg;
-        bool wrong_setup = false;
+        int dut, midpoint, max, lowbits;
+        int total[TOOL_MAX_DUT];
+        byte low, high;
         
-        memset(temp, 0x00, sizeof(temp));
+        memset(total, 0, sizeof(total));
         
-        for (int d = 0; listDut[d] != 0; d++)
+        if (CheckSetup(false, "ASICregister.ConvertFromInt"))
         {
-            dut = listDut[d] - 1;
-            index = ((0 * TOOL_MAX_DUT) + dut);
+            BitCalcs(&midpoint, &max);
+            SiteConverter::FromInt(conversion.type, values, total, midpoint, max);
+        }
+        
+        if (num_registers == 2)
+        {
+            // separate into 2 bytes (same as SeparateBytes)
+            low = 0;
+            high = 1;
+            if ( (lsb != ADDR_INVALID) && (msb != ADDR_INVALID) )
+            {
+                low = lsb;
+                high = msb;
+            }
+            lowbits = bitcount[low];
             
-            switch(conversion.type)
+            for (int d = 0; listDut[d] != 0; d++)
             {
-            case convert_bit:
-            case convert_byte:
-                temp[0] = (byte)(values[dut]);
-                
-                if (num_registers > 1)
-                    wrong_setup = true;
-                
-                break;
-                
-            case convert_uint:
-                if (num_registers == 1)
-                    temp[0] = (byte)(values[index]);
-                else if (num_registers == 2)
-                {
-                    // separate into 2 bytes (cast values as word)
-                    SeparateBytes((word)values[dut], &temp[0]);
-                }
-                else
-                    wrong_setup = true;
-                
-                break;
-                
-            case convert_SN:
-                sprintf(msg, "ASICregister currently doesn't support %s", conversion.name.c_str());
-                ERRChk(ERROR_UNIMPLEMENTED, msg);
-                
-                // TODO: decide on implementation of this
-                
-                break;
-                
-            case twos_comp:
-                BitCalcs(&midpoint, &max);
-                
-                toconvert = ((values[index] >= 0) ? values[index] : (values[index] + max));
-                
-                if (num_registers == 1)
-                    temp[0] = (byte)(toconvert);
-                else if (num_registers == 2)
-                {
-                    // separate into 2 bytes (cast values as word)
-                    SeparateBytes((word)toconvert, &temp[0]);
-                }
-                else
-                    wrong_setup = true;
-                
-                break;
-                
-            /* don't need to undo Nathan's weird shift since midpoint is mapped
-               to midpoint - 1 and there's no going back...*/
-            case twos_comp_invert_neg:
-                BitCalcs(&midpoint, &max);
-                
-                toconvert = ((values[index] > 0) ? (values[index] - 1) : ((midpoint + 1) - values[index]));
+                dut = listDut[d] - 1;
+                output[(low * TOOL_MAX_DUT) + dut] = (byte)(total[dut] & ((1 << lowbits) - 1));
+                output[(high * TOOL_MAX_DUT) + dut] = (byte)((word)total[dut] >> lowbits);
                 
-                if (num_registers == 1)
-                    temp[0] = (byte)(toconvert);
-                else if (num_registers == 2)
+                if (DBGVerify >= ENG_LEVEL_3)
                 {
-                    // separate into 2 bytes (cast values as word)
-                    SeparateBytes((word)toconvert, &temp[0]);
+                    byte temp[APP_MAX_ADDR];
+                    SeparateBytes((word)total[dut], &temp[0]);
                 }
-                else
-                    wrong_setup = true;
-                
-                break;
-                
-            case twos_comp_invert_pos:
-                sprintf(msg, "ASICregister currently doesn't support %s", conversion.name.c_str());
-                ERRChk(ERROR_UNIMPLEMENTED, msg);
-                break;
-                
-            case sense_output:
-                sprintf(msg, "You should never try to set a register of %s", conversion.name.c_str());
-                ERRChk(ERROR_UNDEFINED, msg, "ASICregister.ConvertFromInt", YES);
-                break;
-                
-            default:
-                ERRChk(ERROR_UNDEFINED, "No such conversion-type exists.");
-                break;
             }
+        }
+        else
+        {
+            for (int d = 0; listDut[d] != 0; d++)
+            {
+                dut = listDut[d] - 1;
+                for (int i = 0; i < num_registers; i++)
+                    output[(i * TOOL_MAX_DUT) + dut] = (i == 0) ? (byte)total[dut] : 0x00;
+            }
+        }
+    }
+    
+    // convert count registers at once: values[count][APP_MAX_ADDR][TOOL_MAX_DUT]
+    // into output[count][TOOL_MAX_DUT]
+    static void ConvertToInt(const ASICregister* const* regs, int count, byte* values, int* output, word* listDut)
+    {
+        for (int r = 0; r < count; r++)
+            regs[r]->ConvertToInt(&values[r * APP_MAX_ADDR * TOOL_MAX_DUT], &output[r * TOOL_MAX_DUT], listDut);
+    }
+    
+    // convert count burst reads straight into ints: raw[count][size][TOOL_MAX_DUT]
+    // holds size bytes read from address low, and the row of sites for each
+    // read goes stride ints after the one before in output
+    void ConvertBursts(const byte* raw, byte low, int size, int count, int* output, int stride, word* listDut) const
+    {
+        int midpoint, max;
+        byte values[APP_MAX_ADDR][TOOL_MAX_DUT];
+        int total[TOOL_MAX_DUT];
+        
+        if (!CheckSetup(true, "ASICregister.ConvertBursts"))
+            return;
+        
+        BitCalcs(&midpoint, &max);
+        memset(values, 0, sizeof(values));
+        
+        for (int s = 0; s < count; s++)
+        {
+            const byte* burst = &raw[s * size * TOOL_MAX_DUT];
             
-            if (wrong_setup)
+            for (int a = 0; a < num_registers; a++)
             {
-                sprintf(msg, "ASICregister %s is incorrectly setup with %i bytes and %s", name, num_registers, conversion.name.c_str());
-                ERRChk(ERROR_ASIC_SPECIFIC, msg, "ASICregister.ConvertFromInt", YES);
+                if (Address(a) != ADDR_INVALID)
+                    memcpy(values[a], &burst[(Address(a) - low) * TOOL_MAX_DUT], TOOL_MAX_DUT);
             }
             
-            for (int i = 0; i < num_registers; i++)
+            MaskAndShift(&values[0][0], listDut);
+            
+            if (num_registers == 2)
+                CombineRows(&values[0][0], total);
+            else
             {
-                index = (i * TOOL_MAX_DUT) + dut;
-                output[index] = temp[i];
+                for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+                    total[dut] = values[0][dut];
             }
+            
+            SiteConverter::ToInt(conversion.type, total, &output[s * stride], midpoint, max);
         }
     }
     
-    // shifts highbyte up and combines 2 bytes (assume MaskAndShift already called)
-    word CombineBytes(byte* values, int dut)
+    // convert count registers at once: values[count][TOOL_MAX_DUT] into
+    // output[count][APP_MAX_ADDR][TOOL_MAX_DUT]
+    static void ConvertFromInt(const ASICregister* const* regs, int count, int* values, byte* output, word* listDut)
     {
-        String msg;
-        byte lowbyte, highbyte;
-        word combined;
+        for (int r = 0; r < count; r++)
+            regs[r]->ConvertFromInt(&values[r * TOOL_MAX_DUT], &output[r * APP_MAX_ADDR * TOOL_MAX_DUT], listDut);
+    }
+    
+    // address of byte a (a single address register with multiple bytes is
+    // consecutive bytes from addr[0])
+    byte Address(int a) const
+    {
+        if ( (a >= num_registers) && (a > 0) )
+            return ADDR_INVALID;
         
-        // both the msb and the lsb have valid numbers
-        if( (lsb != ADDR_INVALID) && (msb != ADDR_INVALID) )
+        if ( (addr[1] == ADDR_INVALID) && (addr[0] != ADDR_INVALID) )
+            return (byte)(addr[0] + a);
+        
+        return addr[a];
+    }
+    
+    // group the addresses into runs of consecutive addresses (first index
+    // and number of bytes in each), so a multiple address register can be
+    // moved with one burst per run instead of one transfer per address
+    int Runs(int* first, int* count) const
+    {
+        int num = 0;
+        
+        for (int a = 0; a < num_registers; a++)
         {
-            lowbyte = values[((lsb * TOOL_MAX_DUT) + dut)];
-            highbyte = values[((msb * TOOL_MAX_DUT) + dut)];
+            if (addr[a] == ADDR_INVALID)
+                continue;
             
-            // shift and combine
-            combined = ((highbyte << bitcount[lsb]) | lowbyte );
-        }
-        // assume 1st byte is the lowbyte and the 2nd byte is the highbyte
+            if ( (num > 0) && (first[num - 1] + count[num - 1] == a) &&
+                (addr[a] == addr[a - 1] + 1) )
+            {
+                count[num - 1]++;
+            }
+            else
+            {
+                first[num] = a;
+                count[num] = 1;
+                num++;
+            }
+        }
+        
+        return num;
+    }
+    
+    // combine 2 bytes for every site at once (same as CombineBytes)
+    void CombineRows(const byte* values, int* total) const
+    {
+        int low = 0;
+        int high = 1;
+        
+        if ( (lsb != ADDR_INVALID) && (msb != ADDR_INVALID) )
+        {
+            low = lsb;
+            high = msb;
+        }
+        
+        const byte* lowrow = &values[low * TOOL_MAX_DUT];
+        const byte* highrow = &values[high * TOOL_MAX_DUT];
+        int lowbits = bitcount[low];
+        
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+            total[dut] = (word)((highrow[dut] << lowbits) | lowrow[dut]);
+    }
+    
+    // shifts highbyte up and combines 2 bytes (assume MaskAndShift already called)
+    word CombineBytes(byte* values, int dut) const
+    {
+        String msg;
+        byte lowbyte, highbyte;
+        word combined;
+        
+        // both the msb and the lsb have valid numbers
+        if( (lsb != ADDR_INVALID) && (msb != ADDR_INVALID) )
+        {
+            lowbyte = values[((lsb * TOOL_MAX_DUT) + dut)];
+            highbyte = values[((msb * TOOL_MAX_DUT) + dut)];
+            
+            // shift and combine
+            combined = ((highbyte << bitcount[lsb]) | lowbyte );
+        }
+        // assume 1st byte is the lowbyte and the 2nd byte is the highbyte
         else
         {
             lowbyte = values[((0 * TOOL_MAX_DUT) + dut)];
@@ -679,7 +931,7 @@ typedef struct ASICregister
     }
     
     // separates 2 bytes and shifts highbyte back down (assume ShiftAndMask already called)
-    void SeparateBytes(word input, byte* valuesOut)
+    void SeparateBytes(word input, byte* valuesOut) const
     {
         String msg;
         byte lowbyte, highbyte;
@@ -728,7 +980,7 @@ typedef struct ASICregister
     }
     
     // Calculate the minimum and maximum values that can be set to a register
-    void Range(int* pmin, int* pmax)
+    void Range(int* pmin, int* pmax) const
     {
         String msg;
         int min = 0;
@@ -806,7 +1058,7 @@ typedef struct ASICregister
         // catch when min and max did not get set properly
         if (min >= max)
         {
-            sprintf(msg, "Incorrect range of (%i, %i) for %s since it is setup with %i byte(s) and %s.", min, max, name.c_str(), num_registers, conversion.name.c_str());
+            sprintf(msg, "Incorrect range of (%i, %i) for %s since it is setup with %i byte(s) and %s.", min, max, name, num_registers, conversion.Name());
             ERRChk(ERROR_ASIC_SPECIFIC, msg, "ASICregister.Range", YES);
         }
         
@@ -814,8 +1066,43 @@ typedef struct ASICregister
         *pmax = max;
     }
     
+    // check the input for every site against Range (result is per DUT),
+    // returns true if all DUTs are in range
+    bool InRange(const int* input, bool* result, word* listDut) const
+    {
+        int min, max, dut;
+        bool ok[TOOL_MAX_DUT];
+        bool all = true;
+        
+        Range(&min, &max);
+        
+        for (dut = 0; dut < TOOL_MAX_DUT; dut++)
+            ok[dut] = (input[dut] >= min) & (input[dut] <= max);
+        
+        for (int d = 0; listDut[d] != 0; d++)
+        {
+            dut = listDut[d] - 1;
+            result[dut] = ok[dut];
+            all &= ok[dut];
+        }
+        
+        return all;
+    }
+    
+    // range check count registers at once: input[count][TOOL_MAX_DUT] and
+    // result[count][TOOL_MAX_DUT], returns true if everything is in range
+    static bool InRange(const ASICregister* const* regs, int count, const int* input, bool* result, word* listDut)
+    {
+        bool all = true;
+        
+        for (int r = 0; r < count; r++)
+            all &= regs[r]->InRange(&input[r * TOOL_MAX_DUT], &result[r * TOOL_MAX_DUT], listDut);
+        
+        return all;
+    }
+    
     // total bitcount of register
-    int TotalBits(void)
+    int TotalBits(void) const
     {
         int total_bitcount = 0;
         
@@ -826,7 +1113,7 @@ typedef struct ASICregister
     }
     
     // calculate middle and max values based on ASICregister size (# of bytes)
-    void BitCalcs(int* midpoint, int* max_value)
+    void BitCalcs(int* midpoint, int* max_value) const
     {
         int total_bitcount = TotalBits();
         
@@ -858,6 +1145,8 @@ typedef struct ASICregister
             return false;
         if (memory != a.memory)
             return false;
+        if (num_registers != a.num_registers)
+            return false;
         
         for (int i = 0; i < APP_MAX_ADDR; i++)
         {
@@ -870,7 +1159,7 @@ typedef struct ASICregister
     }
     
     // print all information on a register
-    void Print(void)
+    void Print(void) const
     {
         char msg[APP_MAX_CHAR_LONGER];
         String temp;
@@ -890,10 +1179,10 @@ typedef struct ASICregister
             strcat_s(msg, APP_MAX_CHAR_LONGER, temp);
         }
         
-        sprintf(temp, "Read as: %s\n", conversion.name.c_str() );
+        sprintf(temp, "Read as: %s\n", conversion.Name() );
         strcat(msg, temp);
         
-        sprintf(temp, "Memory Type: %s\n", memory.name.c_str());
+        sprintf(temp, "Memory Type: %s\n", memory.Name());
         strcat(msg, temp);
         
         sprintf(temp, "Number of bytes: %i\n", num_registers);
@@ -926,59 +1215,519 @@ struct find_address : unary_function<ASICregister, bool>
 
 struct find_name : unary_function<ASICregister, bool>
 {
-    string name;
-    find_name(string name) : name(name) {}
+    const char* name;
+    find_name(const char* name) : name(name) {}
     bool operator() (const ASICregister& reg) const
     {
-        if (name == reg.name.c_str())
+        if (strcmp(name, reg.name) == 0)
             return true;
         else
             return false;
     }
 };
 
+//-----------------------------------------------------------------------------
+//  register index
+//  Built once after a vector of registers is set up.  Maps each byte
+//  (page, addr) to the registers that use it, and keeps the registers sorted
+//  by name, so lookups do not scan the vector.  Results are positions in the
+//  vector (the regid for a RegisterTable).  Rebuild after adding registers,
+//  and after copying the vector (the index points at the one it was built
+//  over).
+typedef struct RegisterIndex
+{
+    // registers using byte (page, addr) are ByAddr[Start[slot]] up to
+    // ByAddr[Start[slot + 1]], smallest register (most specific) first
+    word Start[(NUM_PAGES * MAX_PAGE_SIZE) + 1];
+    vector<regid> ByAddr;
+    vector<regid> ByName;
+    const vector<ASICregister>* Registers;
+    
+    RegisterIndex(void) : Registers(NULL)
+    {
+        memset(Start, 0, sizeof(Start));
+    }
+    
+    bool Built(void) const { return (Registers != NULL); }
+    
+    // addr is an int so consecutive bytes past the end of a page don't wrap
+    static int Slot(byte page, int addr)
+    {
+        if ( (page >= NUM_PAGES) || (addr < 0) || (addr >= MAX_PAGE_SIZE) )
+            return -1;
+        return (page * MAX_PAGE_SIZE) + addr;
+    }
+    
+    // calls Visit(slot) for each byte the register uses
+    template <class Visitor>
+    static void EachByte(const ASICregister& reg, Visitor& Visit)
+    {
+        int slot;
+        
+        // multiple addresses
+        if (reg.addr[1] != ADDR_INVALID)
+        {
+            for (int a = 0; a < APP_MAX_ADDR; a++)
+            {
+                if ( (reg.addr[a] != ADDR_INVALID) && ((slot = Slot(reg.page, reg.addr[a])) >= 0) )
+                    Visit(slot);
+            }
+        }
+        // single address (possibly multiple consecutive bytes)
+        else
+        {
+            for (int a = 0; a < max(1, (int)reg.num_registers); a++)
+            {
+                if ((slot = Slot(reg.page, (int)reg.addr[0] + a)) >= 0)
+                    Visit(slot);
+            }
+        }
+    }
+    
+    struct CountByte
+    {
+        word* Start;
+        void operator()(int slot) { Start[slot + 1]++; }
+    };
+    
+    struct FillByte
+    {
+        word* Next;
+        vector<regid>* ByAddr;
+        regid id;
+        void operator()(int slot) { (*ByAddr)[Next[slot]++] = id; }
+    };
+    
+    struct FewerBytes
+    {
+        const vector<ASICregister>* Registers;
+        bool operator()(regid a, regid b) const
+        {
+            return (*Registers)[a].num_registers < (*Registers)[b].num_registers;
+        }
+    };
+    
+    struct NameOrder
+    {
+        const vector<ASICregister>* Registers;
+        bool operator()(regid a, regid b) const
+        {
+            return strcmp((*Registers)[a].name, (*Registers)[b].name) < 0;
+        }
+        bool operator()(regid a, const char* b) const
+        {
+            return strcmp((*Registers)[a].name, b) < 0;
+        }
+        bool operator()(const char* a, regid b) const
+        {
+            return strcmp(a, (*Registers)[b].name) < 0;
+        }
+    };
+    
+    void Build(const vector<ASICregister>& regs)
+    {
+        const int slots = NUM_PAGES * MAX_PAGE_SIZE;
+        Registers = &regs;
+        
+        // count registers per byte, then prefix sum into start positions
+        CountByte counter = { Start };
+        memset(Start, 0, sizeof(Start));
+        for (size_t r = 0; r < regs.size(); r++)
+            EachByte(regs[r], counter);
+        for (int slot = 0; slot < slots; slot++)
+            Start[slot + 1] += Start[slot];
+        
+        // fill (registers are visited in order, so each byte is in order)
+        word next[NUM_PAGES * MAX_PAGE_SIZE];
+        memcpy(next, Start, sizeof(next));
+        ByAddr.assign(Start[slots], REGID_INVALID);
+        
+        FillByte filler = { next, &ByAddr, 0 };
+        for (size_t r = 0; r < regs.size(); r++)
+        {
+            filler.id = (regid)r;
+            EachByte(regs[r], filler);
+        }
+        
+        FewerBytes fewer = { Registers };
+        for (int slot = 0; slot < slots; slot++)
+        {
+            if (Start[slot + 1] - Start[slot] > 1)
+                stable_sort(ByAddr.begin() + Start[slot], ByAddr.begin() + Start[slot + 1], fewer);
+        }
+        
+        // names
+        NameOrder order = { Registers };
+        ByName.resize(regs.size());
+        for (size_t r = 0; r < regs.size(); r++)
+            ByName[r] = (regid)r;
+        sort(ByName.begin(), ByName.end(), order);
+    }
+    
+    // all registers using byte (page, addr), returns how many
+    int AtAddress(byte page, byte addr, const regid** found) const
+    {
+        int slot = Slot(page, addr);
+        
+        if ( (slot < 0) || (Start[slot] == Start[slot + 1]) )
+        {
+            *found = NULL;
+            return 0;
+        }
+        
+        *found = &ByAddr[Start[slot]];
+        return Start[slot + 1] - Start[slot];
+    }
+    
+    // most specific register using byte (page, addr)
+    regid Find(byte page, byte addr) const
+    {
+        const regid* found;
+        return AtAddress(page, addr, &found) ? found[0] : REGID_INVALID;
+    }
+    
+    regid Find(const char* name) const
+    {
+        if (Registers == NULL)
+            return REGID_INVALID;
+        
+        NameOrder order = { Registers };
+        vector<regid>::const_iterator it = lower_bound(ByName.begin(), ByName.end(), name, order);
+        
+        if ( (it != ByName.end()) && (strcmp((*Registers)[*it].name, name) == 0) )
+            return *it;
+        return REGID_INVALID;
+    }
+} RegisterIndex;
+
+//-----------------------------------------------------------------------------
+//  register table
+//  Every register defined on the ASIC gets an ID (its index here), so callers
+//  can refer to a register by a 2-byte handle instead of copying the struct.
+typedef struct RegisterTable
+{
+    vector<ASICregister> Registers;
+    RegisterIndex Index;
+    
+    RegisterTable(void) {}
+    
+    // the copy gets its own index (the source's points at the source)
+    RegisterTable(const RegisterTable& table) : Registers(table.Registers), Index(table.Index)
+    {
+        if (Index.Built())
+            Index.Build(Registers);
+    }
+    
+    RegisterTable& operator=(const RegisterTable& table)
+    {
+        if (this != &table)
+        {
+            Registers = table.Registers;
+            Index = table.Index;
+            if (Index.Built())
+                Index.Build(Registers);
+        }
+        return *this;
+    }
+    
+    int Size(void) const { return (int)Registers.size(); }
+    
+    void Clear(void) { Registers.clear(); Index = RegisterIndex(); }
+    
+    bool Valid(regid id) const { return (id < Registers.size()); }
+    
+    const ASICregister& operator[](regid id) const { return Registers[id]; }
+    
+    const char* Name(regid id) const
+    {
+        return Valid(id) ? Registers[id].name : "invalid";
+    }
+    
+    // lookups (call BuildIndex once all registers have been added)
+    void BuildIndex(void) { Index.Build(Registers); }
+    
+    regid Find(byte page, byte addr) const { return Index.Find(page, addr); }
+    regid Find(const char* name) const { return Index.Find(name); }
+    
+    int AtAddress(byte page, byte addr, const regid** found) const
+    {
+        return Index.AtAddress(page, addr, found);
+    }
+    
+    // assign an ID to the register (and store it), returns REGID_INVALID if
+    // the register is not defined on this ASIC
+    regid Add(ASICregister& reg)
+    {
+        if (reg.addr[0] == ADDR_INVALID)
+            return REGID_INVALID;
+        
+        // already indexed
+        if ( Valid(reg.id) && (Registers[reg.id] == reg) )
+            return reg.id;
+        
+        reg.id = (regid)Registers.size();
+        Registers.push_back(reg);
+        
+        return reg.id;
+    }
+} RegisterTable;
+
+//-----------------------------------------------------------------------------
+//  RAM extraction plan
+//  Each RAM value is compiled once (at init) into the byte offsets, masks, and
+//  shifts needed to pull it out of a raw image, so a whole image can be
+//  converted for every site without going through each ASICregister.
+typedef struct ExtractStep
+{
+    byte            low;            // image offset of the low byte
+    byte            high;           // image offset of the high byte
+    byte            lowmask;
+    byte            highmask;       // 0x00 for single byte values
+    byte            lowshift;
+    byte            highshift;
+    byte            lowbits;        // high byte is shifted up by this
+    contype         type;
+    bool            valid;          // false: value is not in image / supported
+    int             midpoint;       // from BitCalcs
+    int             max_value;
+} ExtractStep;
+
+typedef struct ExtractPlan
+{
+    ExtractStep     Steps[NUM_RAM_VALUES];
+    int             count;
+    
+    ExtractPlan(void) : count(0) {}
+    
+    // build a step for each register in an image that starts at base
+    void Compile(const vector<ASICregister>& regs, byte base, int size)
+    {
+        String msg;
+        int outside = 0;
+        
+        count = min((int)regs.size(), NUM_RAM_VALUES);
+        memset(Steps, 0, sizeof(Steps));
+        
+        for (int r = 0; r < count; r++)
+        {
+            const ASICregister& reg = regs[r];
+            ExtractStep& step = Steps[r];
+            int lo = 0;
+            int hi = 0;
+            int bytes = reg.num_registers;
+            
+            // same byte order as CombineBytes
+            if ( (reg.lsb != ADDR_INVALID) && (reg.msb != ADDR_INVALID) )
+            {
+                lo = reg.lsb;
+                hi = reg.msb;
+            }
+            else if (bytes == 2)
+                hi = 1;
+            
+            step.type = reg.conversion.type;
+            step.valid = ( (bytes == 1) || (bytes == 2) ) &&
+                         (step.type != convert_SN) && (step.type != twos_comp_invert_pos);
+            
+            // single address but consecutive bytes
+            byte lowaddr = reg.addr[lo];
+            byte highaddr = (reg.addr[hi] != ADDR_INVALID) ? reg.addr[hi] : (byte)(reg.addr[0] + hi);
+            
+            if ( step.valid && ((lowaddr < base) || (lowaddr - base >= size) ||
+                                (highaddr < base) || (highaddr - base >= size)) )
+            {
+                outside++;
+                step.valid = false;
+            }
+            
+            if (!step.valid)
+                continue;
+            
+            // a single address register uses one mask for every byte
+            int himask = (reg.addr[1] != ADDR_INVALID) ? hi : 0;
+            
+            step.low = lowaddr - base;
+            step.lowmask = reg.mask[lo];
+            step.lowshift = reg.shift[lo];
+            step.lowbits = reg.bitcount[lo];
+            step.high = (bytes == 2) ? (byte)(highaddr - base) : step.low;
+            step.highmask = (bytes == 2) ? reg.mask[himask] : 0x00;
+            step.highshift = (bytes == 2) ? reg.shift[himask] : 0;
+            reg.BitCalcs(&step.midpoint, &step.max_value);
+        }
+        
+        if (outside > 0)
+        {
+            sprintf(msg, "%i RAM register(s) are outside of the RAM image and will not be converted.", outside);
+            ERRWarn(msg);
+        }
+    }
+    
+    // convert raw[image][TOOL_MAX_DUT] into output[value][TOOL_MAX_DUT]
+    // NOTE: every site is converted (sites not tested convert whatever is in
+    //       raw), which keeps the inner loops free of listDut lookups
+    void Run(const byte* raw, int* output) const
+    {
+        int total[TOOL_MAX_DUT];
+        
+        for (int r = 0; r < count; r++)
+        {
+            const ExtractStep& step = Steps[r];
+            int* out = &output[r * TOOL_MAX_DUT];
+            
+            if (!step.valid)
+            {
+                memset(out, 0, TOOL_MAX_DUT * sizeof(int));
+                continue;
+            }
+            
+            const byte* lowrow = &raw[step.low * TOOL_MAX_DUT];
+            const byte* highrow = &raw[step.high * TOOL_MAX_DUT];
+            
+            // mask, shift, and combine (high byte is masked to 0 if unused)
+            for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+            {
+                total[dut] = ( ((highrow[dut] & step.highmask) >> step.highshift) << step.lowbits ) |
+                             ( (lowrow[dut] & step.lowmask) >> step.lowshift );
+            }
+            
+            // convert (same results as ASICregister::ConvertToInt)
+            if (!SiteConverter::ToInt(step.type, total, out, step.midpoint, step.max_value))
+                memcpy(out, total, TOOL_MAX_DUT * sizeof(int));
+        }
+    }
+} ExtractPlan;
+
 //-----------------------------------------------------------------------------
 //  RAM register struct
 typedef struct RAMstruct
 {
     vector<ASICregister> RAMvector;  // contains all RAM registers in ASIC
     int count;                       // number of bytes in RAM registers
+    bool used[MAX_PAGE_SIZE];        // RAM bytes used by a register
+    bool sorted;                     // RAMvector sorted and indexed
+    RegisterIndex Index;             // lookup into RAMvector
+    ExtractPlan Plan;                // used to convert a RAM image
     
-    RAMstruct(void) { count = 0; }
+    RAMstruct(void) : count(0), sorted(true)
+    {
+        memset(used, false, sizeof(used));
+    }
+    
+    // the copy gets its own index (the source's points at the source)
+    RAMstruct(const RAMstruct& ram) : RAMvector(ram.RAMvector), count(ram.count),
+        sorted(ram.sorted), Index(ram.Index), Plan(ram.Plan)
+    {
+        memcpy(used, ram.used, sizeof(used));
+        if (Index.Built())
+            Index.Build(RAMvector);
+    }
+    
+    RAMstruct& operator=(const RAMstruct& ram)
+    {
+        if (this != &ram)
+        {
+            RAMvector = ram.RAMvector;
+            count = ram.count;
+            memcpy(used, ram.used, sizeof(used));
+            sorted = ram.sorted;
+            Index = ram.Index;
+            Plan = ram.Plan;
+            if (Index.Built())
+                Index.Build(RAMvector);
+        }
+        return *this;
+    }
     
     int Size(void) { return count; }
     
-    void Add(ASICregister reg)
+    struct MarkByte
     {
-        vector<ASICregister>::iterator it;
-        
-        // add register to vector if it's not already in it
-        if (find(RAMvector.begin(), RAMvector.end(), reg) != RAMvector.end())
-            ERRWarn("Tried to Add an ASICregister to RAMstruct more than once.");
-        else
+        bool* used;
+        int* count;
+        void operator()(int slot)
         {
-            // keep track of the number of bytes in RAM
-            count += reg.num_registers;
-            for (int i = 0; i < APP_MAX_ADDR; i++)
+            // slot is (page * MAX_PAGE_SIZE) + addr
+            if (!used[slot % MAX_PAGE_SIZE])
             {
-                if (reg.addr[i] != ADDR_INVALID)
-                {
-                    it = find_if(RAMvector.begin(), RAMvector.end(), find_address(reg.addr[i]));
-                    if (it != RAMvector.end())
-                        count--;
-                }
+                used[slot % MAX_PAGE_SIZE] = true;
+                (*count)++;
             }
-            
-            RAMvector.push_back(reg);
+        }
+    };
+    
+    // NOTE: vector is sorted and checked for repeats once in Finalize
+    void Add(const ASICregister& reg)
+    {
+        // keep track of the number of bytes in RAM
+        MarkByte mark = { used, &count };
+        RegisterIndex::EachByte(reg, mark);
+        
+        RAMvector.push_back(reg);
+        sorted = false;
+    }
+    
+    struct AddressOrder
+    {
+        bool operator()(const ASICregister& a, const ASICregister& b) const
+        {
+            if (a < b)
+                return true;
+            if (b < a)
+                return false;
+            if (a.mask[0] != b.mask[0])
+                return a.mask[0] < b.mask[0];
+            return a.num_registers < b.num_registers;
+        }
+    };
+    
+    // sort by address (low to high), remove repeats (same bytes, masks and
+    // size), and build the index
+    void Finalize(void)
+    {
+        if (sorted)
+            return;
+        
+        sort(RAMvector.begin(), RAMvector.end(), AddressOrder());
+        
+        vector<ASICregister>::iterator it = unique(RAMvector.begin(), RAMvector.end());
+        if (it != RAMvector.end())
+        {
+            ERRWarn("Tried to Add an ASICregister to RAMstruct more than once.");
+            RAMvector.erase(it, RAMvector.end());
         }
         
-        // keep vector sorted by address (low to high)
-        sort(RAMvector.begin(), RAMvector.end());
+        Index.Build(RAMvector);
+        sorted = true;
+    }
+    
+    // position in RAMvector of the most specific register using addr, or
+    // REGID_INVALID
+    regid Find(byte addr)
+    {
+        Finalize();
+        return RAMvector.empty() ? REGID_INVALID : Index.Find(RAMvector.begin()->page, addr);
+    }
+    
+    // position in RAMvector of the register with name, or REGID_INVALID
+    regid Find(const char* name)
+    {
+        Finalize();
+        return Index.Find(name);
+    }
+    
+    // compile the plan used to convert an image read with raw (RawRAM)
+    void CompilePlan(const ASICregister& raw)
+    {
+        Finalize();
+        Plan.Compile(RAMvector, raw.addr[0], min((int)raw.num_registers, NUM_RAM_REG));
     }
     
     // ensure it contains all RAM registers and values
     void Check(void)
     {
+        Finalize();
+        
         if (Size() != NUM_RAM_REG)
         {
             String msg;
@@ -1011,6 +1760,8 @@ typedef struct RAMstruct
         String temp;
         vector<ASICregister>::iterator it;
         
+        Finalize();
+        
         sprintf(msg, "\nRAM Registers:");
         
         #ifdef _HAS_PAGES_
@@ -1022,7 +1773,7 @@ typedef struct RAMstruct
         
         for (it = RAMvector.begin(); it != RAMvector.end(); ++it)
         {
-            sprintf(temp, "Register %02X: %s\n", it->addr[0], it->name.c_str());
+            sprintf(temp, "Register %02X: %s\n", it->addr[0], it->name);
             strcat_s(msg, APP_MAX_CHAR_LONGER, temp);
         }
         
@@ -1091,79 +1842,172 @@ typedef struct RAMstruct
 } RAMstruct;
 
 //-----------------------------------------------------------------------------
-//  Default struct
-//  Used for storing, comparing, and displaying the Default RAM image and mask
-typedef struct Default
+//  Image compare kernel
+//  Compares images in the [reg][TOOL_MAX_DUT] layout a whole row of sites at a
+//  time.  Produces the XOR diff matrix (0 for sites not in listDut) and a pass
+//  bitmask with bit (dut) set for every site that matched.
+STATIC_CHECK(TOOL_MAX_DUT <= 16, site_mask_fits_in_word);
+
+typedef struct ImageCompare
 {
-    byte            SpecImage[NUM_RAM_REG];
-    byte            Mask[NUM_RAM_REG];
+    // lane enables (0xFF for sites in listDut) and the matching site mask
+    static word Sites(word* listDut, byte* enable)
+    {
+        word sites = 0;
+        
+        memset(enable, 0x00, TOOL_MAX_DUT);
+        for (int d = 0; listDut[d] != 0; d++)
+        {
+            enable[listDut[d] - 1] = 0xFF;
+            sites |= (1 << (listDut[d] - 1));
+        }
+        
+        return sites;
+    }
     
-    // default contructor
-    Default(void)
+    // pass bitmask from the OR of all diff rows
+    static word Pass(const byte* failed, word sites)
     {
-        memset(SpecImage, 0x00, sizeof(SpecImage));
-        memset(Mask, 0x00, sizeof(Mask));
+        word pass = sites;
+        
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+            pass &= ~((word)(failed[dut] != 0) << dut);
+        
+        return pass;
     }
     
-    // construct with strings from Spec
-    Default(char* default_in, char* mask_in)
+    // image against image, with an optional mask per register (NULL for none)
+    // NOTE: masked diffs are the full XOR, but only for registers that fail
+    static word Diff(const byte* a, const byte* b, const byte* mask, int count, byte* diff, word* listDut)
     {
-        S2B(default_in, SpecImage, sizeof(SpecImage));
-        S2B(mask_in, Mask, sizeof(Mask));
+        byte enable[TOOL_MAX_DUT];
+        byte failed[TOOL_MAX_DUT];
+        word sites = Sites(listDut, enable);
+        
+        memset(failed, 0x00, sizeof(failed));
+        
+        for (int i = 0; i < count; i++)
+        {
+            const byte* arow = &a[i * TOOL_MAX_DUT];
+            const byte* brow = &b[i * TOOL_MAX_DUT];
+            byte* drow = &diff[i * TOOL_MAX_DUT];
+            byte m = (mask != NULL) ? mask[i] : 0xFF;
+            
+            for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+            {
+                byte x = (arow[dut] ^ brow[dut]) & enable[dut];
+                byte fail = (byte)-(int)((x & m) != 0);
+                drow[dut] = x & fail;
+                failed[dut] |= fail;
+            }
+        }
+        
+        return Pass(failed, sites);
     }
     
-    void Compare(byte* Raw, byte* difference, bool* result, word* listDut)
+    // image against one spec value per register (same for every site), with
+    // an optional mask per register (NULL for none)
+    static word DiffSpec(const byte* raw, const byte* spec, const byte* mask, int count, byte* diff, word* listDut)
     {
-        int dut, index;
-        byte diff[NUM_RAM_REG][TOOL_MAX_DUT];
+        byte enable[TOOL_MAX_DUT];
+        byte failed[TOOL_MAX_DUT];
+        word sites = Sites(listDut, enable);
+        
+        memset(failed, 0x00, sizeof(failed));
+        
+        for (int i = 0; i < count; i++)
+        {
+            const byte* row = &raw[i * TOOL_MAX_DUT];
+            byte* drow = &diff[i * TOOL_MAX_DUT];
+            byte s = spec[i];
+            byte m = (mask != NULL) ? mask[i] : 0xFF;
+            
+            for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+            {
+                byte x = (row[dut] ^ s) & enable[dut];
+                byte fail = (byte)-(int)((x & m) != 0);
+                drow[dut] = x & fail;
+                failed[dut] |= fail;
+            }
+        }
         
-        memset(diff, 0x00, sizeof(diff));
+        return Pass(failed, sites);
+    }
+    
+    // result is true for every site except the ones in listDut that failed
+    static void Result(word pass, bool* result, word* listDut)
+    {
+        int dut;
         
-        // Note: memset will not set a boolean array to true correctly
-        // If the Spec image doesn't match for at least one byte, result will be false for that dut
         for (int i = 0; i < TOOL_MAX_DUT; i++)
             result[i] = true;
         
         for (int d = 0; listDut[d] != 0; d++)
         {
             dut = listDut[d] - 1;
-            for (int i = 0; i < NUM_RAM_REG; i++)
-            {
-                index = (i * TOOL_MAX_DUT) + dut;
-                if ( Raw[index] != SpecImage[i] )
-                {
-                    result[dut] = false;
-                    diff[i][dut] = (Raw[index] ^ SpecImage[i]);
-                }
-            }
+            result[dut] = ((pass >> dut) & 1) != 0;
         }
-        memcpy(difference, diff, sizeof(diff));
     }
     
-    void CompareMasked(byte* Raw, byte* difference, bool* result, word* listDut)
+    // debug output of the diff for every failed site (only builds the strings
+    // when verbose is on)
+    static void Report(byte* diff, int count, word pass, const char* header, word* listDut)
     {
-        int dut, index;
-        byte diff[NUM_RAM_REG][TOOL_MAX_DUT];
-        
-        memset(diff, 0x00, sizeof(diff));
+        int dut;
+        String temp[TOOL_MAX_DUT];
+        char msg[APP_MAX_CHAR_LONGER];
         
-        for (int i = 0; i < TOOL_MAX_DUT; i++)
-            result[i] = true;
+        B2SArray(&temp[0], diff, count, listDut);
         
         for (int d = 0; listDut[d] != 0; d++)
         {
             dut = listDut[d] - 1;
-            for (int i = 0; i < NUM_RAM_REG; i++)
+            
+            if (((pass >> dut) & 1) == 0)
             {
-                index = (i * TOOL_MAX_DUT) + dut;
-                if ( (Raw[index] & Mask[i]) != (SpecImage[i]& Mask[i]) )
-                {
-                    result[dut] = false;
-                    diff[i][dut] = (Raw[index] ^ SpecImage[i]);
-                }
+                sprintf_s(msg, APP_MAX_CHAR_LONGER, "%s [%i]: ", header, dut);
+                strcat_s(msg, APP_MAX_CHAR_LONGER, temp[dut]);
+                DBGVerbose(msg);
             }
         }
-        memcpy(difference, diff, sizeof(diff));
+    }
+} ImageCompare;
+
+//-----------------------------------------------------------------------------
+//  Default struct
+//  Used for storing, comparing, and displaying the Default RAM image and mask
+typedef struct Default
+{
+    byte            SpecImage[NUM_RAM_REG];
+    byte            Mask[NUM_RAM_REG];
+    
+    // default contructor
+    Default(void)
+    {
+        memset(SpecImage, 0x00, sizeof(SpecImage));
+        memset(Mask, 0x00, sizeof(Mask));
+    }
+    
+    // construct with strings from Spec
+    Default(char* default_in, char* mask_in)
+    {
+        S2B(default_in, SpecImage, sizeof(SpecImage));
+        S2B(mask_in, Mask, sizeof(Mask));
+    }
+    
+    // If the Spec image doesn't match for at least one byte, result will be false for that dut
+    word Compare(const byte* Raw, byte* difference, bool* result, word* listDut) const
+    {
+        word pass = ImageCompare::DiffSpec(Raw, SpecImage, NULL, NUM_RAM_REG, difference, listDut);
+        ImageCompare::Result(pass, result, listDut);
+        return pass;
+    }
+    
+    word CompareMasked(const byte* Raw, byte* difference, bool* result, word* listDut) const
+    {
+        word pass = ImageCompare::DiffSpec(Raw, SpecImage, Mask, NUM_RAM_REG, difference, listDut);
+        ImageCompare::Result(pass, result, listDut);
+        return pass;
     }
     
     void Print(void)
@@ -1213,58 +2057,30 @@ typedef struct Image
         memcpy(Raw, raw_in, sizeof(Raw));
     }
     
-    // convert raw register values from byte to int using RAMstruct
-    void Convert(int* output, RAMstruct RAMregisters, word* listDut)
+    // convert raw register values from byte to int using RAMstruct (all
+    // values for all sites in one pass, see ExtractPlan)
+    void Convert(int* output, const RAMstruct& RAMregisters, word* listDut)
     {
-        // TODO: finish
+        RAMregisters.Plan.Run(&Raw[0][0], &Converted[0][0]);
         
-        // for loop over RAMValues.strarray
-        //for (int r = 0; r < RAMValues.count; r++)
-        //{
-            // use find_name to find a register based on name
-            //if (find(RAMvector.begin(), RAMvector.end(), reg) != RAMvector.end())
-            //RAMValues.intarray[r] = RAMregisters.RAMvector[r].ConvertToInt()
-        //}
-        
-        // Need a version on B2S or B2SArray (using C++ string) that makes all RAM 1 string
-        //RAMValues.raw_str = //B2S(&Raw[0][0], NUM_RAM_REG)
+        if ( (output != NULL) && (output != &Converted[0][0]) )
+            memcpy(output, Converted, sizeof(Converted));
     }
     
     // compare array to array of bytes
-    void Compare(byte* otherRaw, byte* difference, bool* result, word* listDut)
+    void Compare(const byte* otherRaw, byte* difference, bool* result, word* listDut)
     {
-        int dut, index;
-        String temp[TOOL_MAX_DUT];
-        char msg[APP_MAX_CHAR_LONGER];
         byte diff[NUM_RAM_REG][TOOL_MAX_DUT];
         
-        memset(diff, 0x00, sizeof(diff));
-        
-        for (int i = 0; i < TOOL_MAX_DUT; i++)
-            result[i] = true;
+        word pass = ImageCompare::Diff(&Raw[0][0], otherRaw, NULL, NUM_RAM_REG, &diff[0][0], listDut);
+        ImageCompare::Result(pass, result, listDut);
         
-        for (int d = 0; listDut[d] != 0; d++)
+        // print difference
+        if (DBGVerboseEnabled)
         {
-            dut = listDut[d] - 1;
-            for (int i = 0; i < NUM_RAM_REG; i++)
-            {
-                index = (i * TOOL_MAX_DUT) + dut;
-                if (Raw[i][dut] != otherRaw[index])
-                {
-                    result[dut] = false;
-                    diff[i][dut] = (Raw[i][dut] ^ otherRaw[index]);
-                }
-            }
-            
-            B2SArray(&temp[0], &diff[0][0], NUM_RAM_REG, listDut);
-            
-            // print difference
-            if (result[dut] == false)
-            {
-                sprintf_s(msg, APP_MAX_CHAR_LONGER, "\n%sImage diff array [%i]: ", memory.name.c_str(), dut);
-                strcat_s(msg, APP_MAX_CHAR_LONGER, temp[dut]);
-                DBGVerbose(msg);
-            }
+            String header;
+            sprintf(header, "\n%sImage diff array", memory.Name());
+            ImageCompare::Report(&diff[0][0], NUM_RAM_REG, pass, header, listDut);
         }
         
         if (difference != NULL)
@@ -1272,101 +2088,54 @@ typedef struct Image
     }
     
     // compare images
-    void Compare(Image img, byte* difference, bool* result, word* listDut)
+    void Compare(const Image& img, byte* difference, bool* result, word* listDut)
     {
-        int dut;
-        String temp[TOOL_MAX_DUT];
-        char msg[APP_MAX_CHAR_LONGER];
         byte diff[NUM_RAM_REG][TOOL_MAX_DUT];
         
-        memset(diff, 0x00, sizeof(diff));
-        
-        for (int i = 0; i < TOOL_MAX_DUT; i++)
-            result[i] = true;
+        word pass = ImageCompare::Diff(&Raw[0][0], &img.Raw[0][0], NULL, NUM_RAM_REG, &diff[0][0], listDut);
+        ImageCompare::Result(pass, result, listDut);
         
-        for (int d = 0; listDut[d] != 0; d++)
+        // print difference
+        if (DBGVerboseEnabled)
         {
-            dut = listDut[d] - 1;
-            for (int i = 0; i < NUM_RAM_REG; i++)
-            {
-                if (Raw[i][dut] != img.Raw[i][dut])
-                {
-                    result[dut] = false;
-                    diff[i][dut] = (Raw[i][dut] ^ img.Raw[i][dut]);
-                }
-            }
-            
-            B2SArray(&temp[0], &diff[0][0], NUM_RAM_REG, listDut);
-            
-            // print difference
-            if (result[dut] == false)
-            {
-                sprintf_s(msg, APP_MAX_CHAR_LONGER, "\n%sImage diff %sImage [%i]: ", memory.name.c_str(), img.memory.name.c_str(), dut);
-                strcat_s(msg, APP_MAX_CHAR_LONGER, temp[dut]);
-                DBGVerbose(msg);
-            }
+            String header;
+            sprintf(header, "\n%sImage diff %sImage", memory.Name(), img.memory.Name());
+            ImageCompare::Report(&diff[0][0], NUM_RAM_REG, pass, header, listDut);
         }
         
         if (difference != NULL)
             memcpy(difference, diff, sizeof(diff));
     }
     
-    void CompareDefault(Default DefaultImg, byte* difference, bool* result, word* listDut)
+    void CompareDefault(const Default& DefaultImg, byte* difference, bool* result, word* listDut)
     {
         byte diff[NUM_RAM_REG][TOOL_MAX_DUT];
-        memset(diff, 0x00, sizeof(diff));
         
-        DefaultImg.Compare(&Raw[0][0], &diff[0][0], result, listDut);
+        word pass = DefaultImg.Compare(&Raw[0][0], &diff[0][0], result, listDut);
         
         // debug output of img difference from default img
         if (DBGVerboseEnabled)
         {
-            int dut;
-            String temp[TOOL_MAX_DUT];
-            char msg[APP_MAX_CHAR_LONGER] = "";
-            
-            B2SArray(&temp[0], &diff[0][0], NUM_RAM_REG, listDut);
-            
-            for (int d = 0; listDut[d] != 0; d++)
-            {
-                dut = listDut[d] - 1;
-                
-                if (result[dut] == false)
-                {
-                    sprintf_s(msg, APP_MAX_CHAR_LONGER, "\n%sImage diff DefaultImage [%i]: ", memory.name.c_str(), dut);
-                    strcat_s(msg, APP_MAX_CHAR_LONGER, temp[dut]);
-                    DBGVerbose(msg);
-                }
-            }
+            String header;
+            sprintf(header, "\n%sImage diff DefaultImage", memory.Name());
+            ImageCompare::Report(&diff[0][0], NUM_RAM_REG, pass, header, listDut);
         }
         
         if (difference != NULL)
             memcpy(difference, diff, sizeof(diff));
     }
     
-    void CompareMaskedDefault(Default DefaultImg, byte* difference, bool* result, word* listDut)
+    void CompareMaskedDefault(const Default& DefaultImg, byte* difference, bool* result, word* listDut)
     {
-        int dut;
-        String temp[TOOL_MAX_DUT];
-        char msg[APP_MAX_CHAR_LONGER];
-        
         byte diff[NUM_RAM_REG][TOOL_MAX_DUT];
-        memset(diff, 0x00, sizeof(diff));
-        
-        DefaultImg.CompareMasked(&Raw[0][0], &diff[0][0], result, listDut);
         
-        B2SArray(&temp[0], &diff[0][0], NUM_RAM_REG, listDut);
+        word pass = DefaultImg.CompareMasked(&Raw[0][0], &diff[0][0], result, listDut);
         
-        for (int d = 0; listDut[d] != 0; d++)
+        if (DBGVerboseEnabled)
         {
-            dut = listDut[d] - 1;
-            
-            if (result[dut] == false)
-            {
-                sprintf_s(msg, APP_MAX_CHAR_LONGER, "\nMasked %sImage diff Masked DefaultImage [%i]: ", memory.name.c_str(), dut);
-                strcat_s(msg, APP_MAX_CHAR_LONGER, temp[dut]);
-                DBGVerbose(msg);
-            }
+            String header;
+            sprintf(header, "\nMasked %sImage diff Masked DefaultImage", memory.Name());
+            ImageCompare::Report(&diff[0][0], NUM_RAM_REG, pass, header, listDut);
         }
         
         if (difference != NULL)
@@ -1378,7 +2147,7 @@ typedef struct Image
     {
         String msg;
         String output = B2S(&Raw[0][dut], NUM_RAM_REG);
-        sprintf(msg, "\n%sImage[%i]: %s", memory.name.c_str(), dut, (char*)output);
+        sprintf(msg, "\n%sImage[%i]: %s", memory.Name(), dut, (char*)output);
         
         // always display
         bool was_on = DBGVerboseEnabled;
@@ -1408,7 +2177,7 @@ typedef struct Image
         bool was_on = DBGVerboseEnabled;
         DBGVerboseEnabled = YES;
         
-        sprintf(msg, "\n%sImage[%i]: ", memory.name.c_str(), dut);
+        sprintf(msg, "\n%sImage[%i]: ", memory.Name(), dut);
         
         for (int i; i < NUM_RAM_REG; i++)
         {
@@ -1435,7 +2204,7 @@ typedef struct Image
         {
             dut = listDut[d] - 1;
             
-            sprintf(msg, "\n%sImage[%i]: ", memory.name.c_str(), dut);
+            sprintf(msg, "\n%sImage[%i]: ", memory.Name(), dut);
             
             for (int i = 0; i < NUM_RAM_REG; i++)
             {
@@ -1503,39 +2272,23 @@ typedef struct VolImage
         count = size;
     }
     
-    void Compare(VolImage img, byte* difference, bool* result, word* listDut)
+    void Compare(const VolImage& img, byte* difference, bool* result, word* listDut)
     {
-        int dut;
-        String temp[TOOL_MAX_DUT];
-        char msg[APP_MAX_CHAR_LONGER];
         byte diff[MAX_PAGE_SIZE][TOOL_MAX_DUT];
         
-        memset(diff, 0x00, sizeof(diff));
+        // registers past count are left out of the compare
+        if (count < MAX_PAGE_SIZE)
+            memset(&diff[count][0], 0x00, (MAX_PAGE_SIZE - count) * TOOL_MAX_DUT);
         
-        for (int i = 0; i < TOOL_MAX_DUT; i++)
-            result[i] = true;
+        word pass = ImageCompare::Diff(&Raw[0][0], &img.Raw[0][0], NULL, count, &diff[0][0], listDut);
+        ImageCompare::Result(pass, result, listDut);
         
-        for (int d = 0; listDut[d] != 0; d++)
+        // print difference
+        if (DBGVerboseEnabled)
         {
-            dut = listDut[d] - 1;
-            for (int i = 0; i < count; i++)
-            {
-                if (Raw[i][dut] != img.Raw[i][dut])
-                {
-                    result[dut] = false;
-                    diff[i][dut] = (Raw[i][dut] ^ img.Raw[i][dut]);
-                }
-            }
-            
-            B2SArray(&temp[0], &diff[0][0], count, listDut);
-            
-            // print difference
-            if (result[dut] == false)
-            {
-                sprintf_s(msg, APP_MAX_CHAR_LONGER, "\n%sImage diff %sImage [%i]: ", memory.name.c_str(), img.memory.name.c_str(), dut);
-                strcat_s(msg, APP_MAX_CHAR_LONGER, temp[dut]);
-                DBGVerbose(msg);
-            }
+            String header;
+            sprintf(header, "\n%sImage diff %sImage", memory.Name(), img.memory.Name());
+            ImageCompare::Report(&diff[0][0], count, pass, header, listDut);
         }
         
         if (difference != NULL)
@@ -1547,7 +2300,7 @@ typedef struct VolImage
     {
         String msg;
         String output = B2S(&Raw[0][dut], count);
-        sprintf(msg, "\n%sVolatile Image[%i]: %s", memory.name.c_str(), dut, (char*)output);
+        sprintf(msg, "\n%sVolatile Image[%i]: %s", memory.Name(), dut, (char*)output);
         
         // always display
         bool was_on = DBGVerboseEnabled;
@@ -1579,4 +2332,271 @@ typedef struct VolImage
     }
 } VolImage;
 
+//-----------------------------------------------------------------------------
+//  Write log
+//  Keeps the expected value of every byte written while a verified write is
+//  open (see CDeviceBase::BeginVerify), so the whole operation can be read
+//  back in a burst for each run of bytes written and compared at once.
+typedef struct WriteLog
+{
+    byte            Expected[NUM_PAGES][MAX_PAGE_SIZE][TOOL_MAX_DUT];
+    byte            Readback[MAX_PAGE_SIZE][TOOL_MAX_DUT];
+    word            Sites[NUM_PAGES][MAX_PAGE_SIZE];    // sites written (bit per DUT)
+    int             first[NUM_PAGES];                   // span written on each page
+    int             last[NUM_PAGES];
+    int             depth;                              // nested Begin/End calls
+    
+    WriteLog(void) : depth(0)
+    {
+        Clear();
+    }
+    
+    void Clear(void)
+    {
+        memset(Sites, 0x00, sizeof(Sites));
+        for (int p = 0; p < NUM_PAGES; p++)
+        {
+            first[p] = MAX_PAGE_SIZE;
+            last[p] = -1;
+        }
+    }
+    
+    bool Open(void) const { return (depth > 0); }
+    
+    // pages are numbered like FakeMemory (PAGE_INVALID is page 0)
+    static byte Page(byte page)
+    {
+        return (page == PAGE_INVALID) ? 0 : page;
+    }
+    
+    // record the values written to count bytes at reg_loc
+    void Stage(byte page, byte reg_loc, int count, byte* values, word* listDut)
+    {
+        int dut;
+        word sites = 0;
+        
+        page = Page(page);
+        if ( (page >= NUM_PAGES) || (reg_loc + count > MAX_PAGE_SIZE) )
+            return;
+        
+        for (int d = 0; listDut[d] != 0; d++)
+            sites |= (1 << (listDut[d] - 1));
+        
+        for (int a = 0; a < count; a++)
+        {
+            for (int d = 0; listDut[d] != 0; d++)
+            {
+                dut = listDut[d] - 1;
+                Expected[page][reg_loc + a][dut] = values[(a * TOOL_MAX_DUT) + dut];
+            }
+            Sites[page][reg_loc + a] |= sites;
+        }
+        
+        first[page] = min(first[page], (int)reg_loc);
+        last[page] = max(last[page], reg_loc + count - 1);
+    }
+    
+    // compare Readback (first[page] to last[page]) against Expected, except
+    // the bits set in ignore[MAX_PAGE_SIZE], failed gets the sites that did
+    // not match for each byte, returns the sites that failed anywhere
+    word Compare(byte page, const byte* ignore, word* failed) const
+    {
+        word all = 0;
+        
+        for (int i = first[page]; i <= last[page]; i++)
+        {
+            const byte* read = &Readback[i - first[page]][0];
+            const byte* expect = &Expected[page][i][0];
+            byte check = (byte)~ignore[i];
+            word bad = 0;
+            
+            for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+                bad |= (word)((((read[dut] ^ expect[dut]) & check) != 0) << dut);
+            
+            failed[i] = bad & Sites[page][i];
+            all |= failed[i];
+        }
+        
+        return all;
+    }
+} WriteLog;
+
+//-----------------------------------------------------------------------------
+//  Device snapshot
+//  Volatile, RAM, and ROM for every site in the [reg][TOOL_MAX_DUT] layout
+//  (see CDeviceCore::GetSnapshot).  Serializes as a small header followed by
+//  the raw arrays, so saving and loading is just a few memcpy's.
+#define SNAPSHOT_VERSION    2
+#define SNAPSHOT_LAYOUT     5               // sizes in the header
+
+typedef struct DeviceSnapshot
+{
+    dword           version;
+    word            layout[SNAPSHOT_LAYOUT];            // array sizes (see Layout)
+    word            sites;                              // sites captured (bit per DUT)
+    byte            Volatile[NUM_VOL_REG][TOOL_MAX_DUT];
+#if NUM_VOL_PAGES > 1
+    byte            Volatile_2[NUM_VOL_REG_2][TOOL_MAX_DUT];
+#endif
+    byte            RAM[NUM_RAM_REG][TOOL_MAX_DUT];
+    byte            ROM[NUM_ROM_REG][TOOL_MAX_DUT];
+    
+    DeviceSnapshot(void)
+    {
+        Clear();
+    }
+    
+    void Clear(void)
+    {
+        memset(this, 0x00, sizeof(DeviceSnapshot));
+        version = SNAPSHOT_VERSION;
+        Layout(layout);
+    }
+    
+    // the array sizes of this build, so a blob from a build with other
+    // sizes is rejected instead of misparsed
+    static void Layout(word* sizes)
+    {
+        sizes[0] = TOOL_MAX_DUT;
+        sizes[1] = NUM_VOL_REG;
+#if NUM_VOL_PAGES > 1
+        sizes[2] = NUM_VOL_REG_2;
+#else
+        sizes[2] = 0;
+#endif
+        sizes[3] = NUM_RAM_REG;
+        sizes[4] = NUM_ROM_REG;
+    }
+    
+    // XOR of every byte into diff (may be NULL), keep is an optional mask
+    // for each Volatile byte (outputs and status always change), returns
+    // the sites that match
+    word Diff(const DeviceSnapshot& other, DeviceSnapshot* diff, word* listDut, const byte* keep = NULL) const
+    {
+        DeviceSnapshot temp;
+        DeviceSnapshot* out = (diff != NULL) ? diff : &temp;
+        
+        word pass = ImageCompare::Diff(&Volatile[0][0], &other.Volatile[0][0], keep, NUM_VOL_REG, &out->Volatile[0][0], listDut);
+#if NUM_VOL_PAGES > 1
+        pass &= ImageCompare::Diff(&Volatile_2[0][0], &other.Volatile_2[0][0], NULL, NUM_VOL_REG_2, &out->Volatile_2[0][0], listDut);
+#endif
+        pass &= ImageCompare::Diff(&RAM[0][0], &other.RAM[0][0], NULL, NUM_RAM_REG, &out->RAM[0][0], listDut);
+        pass &= ImageCompare::Diff(&ROM[0][0], &other.ROM[0][0], NULL, NUM_ROM_REG, &out->ROM[0][0], listDut);
+        
+        out->sites = sites & other.sites;
+        
+        return pass;
+    }
+    
+    // bytes needed to serialize
+    static int Size(void)
+    {
+        return sizeof(dword) + sizeof(layout) + sizeof(word) + MemorySize();
+    }
+    
+    // size of all the memory arrays
+    static int MemorySize(void)
+    {
+        int size = (NUM_VOL_REG + NUM_RAM_REG + NUM_ROM_REG) * TOOL_MAX_DUT;
+#if NUM_VOL_PAGES > 1
+        size += NUM_VOL_REG_2 * TOOL_MAX_DUT;
+#endif
+        return size;
+    }
+    
+    // returns the number of bytes written (0 if buffer is too small)
+    int Serialize(byte* buffer, int size) const
+    {
+        if (size < Size())
+            return 0;
+        
+        memcpy(buffer, &version, sizeof(dword));
+        buffer += sizeof(dword);
+        memcpy(buffer, layout, sizeof(layout));
+        buffer += sizeof(layout);
+        memcpy(buffer, &sites, sizeof(word));
+        buffer += sizeof(word);
+        
+        memcpy(buffer, Volatile, sizeof(Volatile));
+        buffer += sizeof(Volatile);
+#if NUM_VOL_PAGES > 1
+        memcpy(buffer, Volatile_2, sizeof(Volatile_2));
+        buffer += sizeof(Volatile_2);
+#endif
+        memcpy(buffer, RAM, sizeof(RAM));
+        buffer += sizeof(RAM);
+        memcpy(buffer, ROM, sizeof(ROM));
+        
+        return Size();
+    }
+    
+    // returns false if the buffer is not a snapshot of this version and
+    // layout
+    bool Deserialize(const byte* buffer, int size)
+    {
+        dword version_in;
+        word layout_in[SNAPSHOT_LAYOUT];
+        word expected[SNAPSHOT_LAYOUT];
+        
+        if (size < Size())
+            return false;
+        
+        memcpy(&version_in, buffer, sizeof(dword));
+        if (version_in != SNAPSHOT_VERSION)
+            return false;
+        buffer += sizeof(dword);
+        
+        memcpy(layout_in, buffer, sizeof(layout_in));
+        Layout(expected);
+        if (memcmp(layout_in, expected, sizeof(expected)) != 0)
+            return false;
+        buffer += sizeof(layout_in);
+        
+        version = version_in;
+        memcpy(layout, layout_in, sizeof(layout));
+        memcpy(&sites, buffer, sizeof(word));
+        buffer += sizeof(word);
+        
+        memcpy(Volatile, buffer, sizeof(Volatile));
+        buffer += sizeof(Volatile);
+#if NUM_VOL_PAGES > 1
+        memcpy(Volatile_2, buffer, sizeof(Volatile_2));
+        buffer += sizeof(Volatile_2);
+#endif
+        memcpy(RAM, buffer, sizeof(RAM));
+        buffer += sizeof(RAM);
+        memcpy(ROM, buffer, sizeof(ROM));
+        
+        return true;
+    }
+    
+    // print all memory for 1 DUT
+    void Print(int dut)
+    {
+        String msg;
+        byte column[MAX_PAGE_SIZE];
+        
+        // always display
+        bool was_on = DBGVerboseEnabled;
+        DBGVerboseEnabled = YES;
+        
+        for (int i = 0; i < NUM_VOL_REG; i++)
+            column[i] = Volatile[i][dut];
+        sprintf(msg, "\nSnapshot Volatile[%i]: %s", dut, (char*)B2S(column, NUM_VOL_REG));
+        DBGVerbose(msg);
+        
+        for (int i = 0; i < NUM_RAM_REG; i++)
+            column[i] = RAM[i][dut];
+        sprintf(msg, "Snapshot RAM[%i]: %s", dut, (char*)B2S(column, NUM_RAM_REG));
+        DBGVerbose(msg);
+        
+        for (int i = 0; i < NUM_ROM_REG; i++)
+            column[i] = ROM[i][dut];
+        sprintf(msg, "Snapshot ROM[%i]: %s", dut, (char*)B2S(column, NUM_ROM_REG));
+        DBGVerbose(msg);
+        
+        DBGVerboseEnabled = was_on;
+    }
+} DeviceSnapshot;
+
 #endif
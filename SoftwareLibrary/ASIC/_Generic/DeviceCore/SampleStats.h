@@ -0,0 +1,456 @@
+/******************************************************************************
+    
+    File:   SampleStats.h
+    Desc:   Statistics of sampled outputs, kept as the samples come in so
+            no samples need to be stored.  Every struct works on a whole row
+            of sites (TOOL_MAX_DUT) at once.
+
+******************************************************************************/
+#ifndef _SAMPLE_STATS_H_
+#define _SAMPLE_STATS_H_
+
+#include "Defines.h"
+#include <limits.h>
+#include <float.h>
+
+#define NUM_QUANTILES       3               // P1, median, and P99
+#define QUANTILE_P1         0
+#define QUANTILE_MEDIAN     1
+#define QUANTILE_P99        2
+
+#define SPIKE_WARMUP        20              // samples before spikes are rejected
+#define MAD_TO_SIGMA        1.4826          // MAD of normal noise to sigma
+
+#define CONFIDENCE_Z        1.96            // 95% confidence intervals
+#define ADAPT_MIN_SAMPLES   10              // samples before a site can stop
+
+#define COMMON_MODE_SITES   3               // other sites needed for a common mode
+
+#define ALLAN_MAX_TAUS      24              // cluster sizes 1, 2, 4 .. 2^23
+#define ALLAN_PHASES        8               // overlapping clusters per size
+
+//-----------------------------------------------------------------------------
+//  sites taking part in a sample: weight[TOOL_MAX_DUT] is 1 for every site in
+//  listDut and 0 for the rest
+inline void SampleWeights(word* listDut, double* weight)
+{
+    for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+        weight[dut] = 0.0;
+    
+    for (int d = 0; listDut[d] != 0; d++)
+        weight[listDut[d] - 1] = 1.0;
+}
+
+//-----------------------------------------------------------------------------
+//  RunningStats: Welford running mean and variance, plus min and max, of
+//  every site
+typedef struct RunningStats
+{
+    double n[TOOL_MAX_DUT];                 // samples taken
+    double mean[TOOL_MAX_DUT];
+    double m2[TOOL_MAX_DUT];                // sum of squared differences
+    int lowest[TOOL_MAX_DUT];
+    int highest[TOOL_MAX_DUT];
+    
+    void Clear(void)
+    {
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+        {
+            n[dut] = 0.0;
+            mean[dut] = 0.0;
+            m2[dut] = 0.0;
+            lowest[dut] = INT_MAX;
+            highest[dut] = INT_MIN;
+        }
+    }
+    
+    // add one sample x[TOOL_MAX_DUT] for the sites with weight 1 (the rest
+    // are left as they are, with no branches in the loop)
+    void Add(const int* x, const double* weight)
+    {
+        double value[TOOL_MAX_DUT];
+        
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+            value[dut] = (double)x[dut];
+        
+        Add(value, weight);
+    }
+    
+    // (lowest and highest are rounded to whole counts)
+    void Add(const double* x, const double* weight)
+    {
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+        {
+            double w = weight[dut];
+            double delta = x[dut] - mean[dut];
+            int whole = (int)floor(x[dut] + 0.5);
+            
+            n[dut] += w;
+            mean[dut] += (w * delta) / (n[dut] + (1.0 - w));
+            m2[dut] += w * delta * (x[dut] - mean[dut]);
+            
+            lowest[dut] = ((w != 0.0) && (whole < lowest[dut])) ? whole : lowest[dut];
+            highest[dut] = ((w != 0.0) && (whole > highest[dut])) ? whole : highest[dut];
+        }
+    }
+    
+    // sample variance (0 with fewer than 2 samples)
+    double Variance(int dut) const
+    {
+        return (n[dut] > 1.0) ? (m2[dut] / (n[dut] - 1.0)) : 0.0;
+    }
+    
+    double StDev(int dut) const
+    {
+        return sqrt(Variance(dut));
+    }
+    
+    // lowest and highest sample (0 with no samples)
+    int Lowest(int dut) const
+    {
+        return (n[dut] > 0.0) ? lowest[dut] : 0;
+    }
+    
+    int Highest(int dut) const
+    {
+        return (n[dut] > 0.0) ? highest[dut] : 0;
+    }
+    
+    // half widths of the confidence intervals on the mean and (normal
+    // noise) on the standard deviation
+    double MeanInterval(int dut) const
+    {
+        return (n[dut] > 1.0) ? (CONFIDENCE_Z * StDev(dut) / sqrt(n[dut])) : DBL_MAX;
+    }
+    
+    double StDevInterval(int dut) const
+    {
+        return (n[dut] > 1.0) ? (CONFIDENCE_Z * StDev(dut) / sqrt(2.0 * (n[dut] - 1.0))) : DBL_MAX;
+    }
+} RunningStats;
+
+//-----------------------------------------------------------------------------
+//  common mode of one sample x[TOOL_MAX_DUT] for every site, common[TOOL_MAX_DUT]:
+//  the median, across the other sites with weight 1, of how far each is
+//  from its own level (the running mean in stats, with the common mode
+//  already taken out).  This is the part all sites share (handler
+//  vibration), without their offsets.  Leaving the site itself out keeps
+//  its own noise out of what is taken off it.  0 for a site with fewer
+//  than COMMON_MODE_SITES other sites that have a level.
+inline void CommonMode(const int* x, const RunningStats& stats, const double* weight, double* common)
+{
+    int i, lo, hi, others, num = 0;
+    int rank[TOOL_MAX_DUT];
+    int site[TOOL_MAX_DUT];
+    double deviation;
+    double sorted[TOOL_MAX_DUT];
+    
+    // deviations of the sites with a level, sorted
+    for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+    {
+        rank[dut] = -1;
+        if ( (weight[dut] == 0.0) || (stats.n[dut] < 1.0) )
+            continue;
+        
+        deviation = (double)x[dut] - stats.mean[dut];
+        for (i = num; (i > 0) && (sorted[i - 1] > deviation); i--)
+        {
+            sorted[i] = sorted[i - 1];
+            site[i] = site[i - 1];
+        }
+        sorted[i] = deviation;
+        site[i] = dut;
+        num++;
+    }
+    
+    for (i = 0; i < num; i++)
+        rank[site[i]] = i;
+    
+    // median of the rest: the middle of the sorted list with the site's
+    // own entry skipped
+    for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+    {
+        others = (rank[dut] < 0) ? num : (num - 1);
+        common[dut] = 0.0;
+        if (others < COMMON_MODE_SITES)
+            continue;
+        
+        lo = (others - 1) / 2;
+        hi = others / 2;
+        if ( (rank[dut] >= 0) && (lo >= rank[dut]) )
+            lo++;
+        if ( (rank[dut] >= 0) && (hi >= rank[dut]) )
+            hi++;
+        
+        common[dut] = (sorted[lo] + sorted[hi]) / 2.0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//  AllanStats: overlapping Allan deviation of every site at cluster sizes of
+//  1, 2, 4 .. samples, from running sums only.  Each size has up to
+//  ALLAN_PHASES sets of back to back clusters, started evenly spread over
+//  one cluster, so the estimate uses every overlap for the small sizes and
+//  ALLAN_PHASES of them for the big ones, whatever the number of samples.
+typedef struct AllanStats
+{
+    double sum[ALLAN_MAX_TAUS][ALLAN_PHASES][TOOL_MAX_DUT];  // cluster so far
+    double last[ALLAN_MAX_TAUS][ALLAN_PHASES][TOOL_MAX_DUT]; // last cluster average
+    int fill[ALLAN_MAX_TAUS][ALLAN_PHASES][TOOL_MAX_DUT];    // samples in it (< 0
+                                                             // until it starts)
+    int done[ALLAN_MAX_TAUS][ALLAN_PHASES][TOOL_MAX_DUT];    // clusters finished
+    double squares[ALLAN_MAX_TAUS][TOOL_MAX_DUT];            // sum of the squared
+    double terms[ALLAN_MAX_TAUS][TOOL_MAX_DUT];              // differences
+    
+    // samples per cluster, and sets of clusters, for each size
+    static int Size(int tau) { return 1 << tau; }
+    static int Phases(int tau) { return min(Size(tau), ALLAN_PHASES); }
+    
+    void Clear(void)
+    {
+        for (int tau = 0; tau < ALLAN_MAX_TAUS; tau++)
+        {
+            for (int ph = 0; ph < Phases(tau); ph++)
+            {
+                for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+                {
+                    sum[tau][ph][dut] = 0.0;
+                    last[tau][ph][dut] = 0.0;
+                    fill[tau][ph][dut] = -(ph * (Size(tau) / Phases(tau)));
+                    done[tau][ph][dut] = 0;
+                }
+            }
+            
+            for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+            {
+                squares[tau][dut] = 0.0;
+                terms[tau][dut] = 0.0;
+            }
+        }
+    }
+    
+    // add the next sample x[TOOL_MAX_DUT] of the sites with weight 1
+    void Add(const int* x, const double* weight)
+    {
+        double average, step;
+        
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+        {
+            if (weight[dut] == 0.0)
+                continue;
+            
+            for (int tau = 0; tau < ALLAN_MAX_TAUS; tau++)
+            {
+                for (int ph = 0; ph < Phases(tau); ph++)
+                {
+                    if (fill[tau][ph][dut]++ < 0)
+                        continue;
+                    
+                    sum[tau][ph][dut] += (double)x[dut];
+                    if (fill[tau][ph][dut] < Size(tau))
+                        continue;
+                    
+                    // a whole cluster: compare it with the one before
+                    average = sum[tau][ph][dut] / Size(tau);
+                    if (done[tau][ph][dut] > 0)
+                    {
+                        step = average - last[tau][ph][dut];
+                        squares[tau][dut] += step * step;
+                        terms[tau][dut] += 1.0;
+                    }
+                    
+                    last[tau][ph][dut] = average;
+                    sum[tau][ph][dut] = 0.0;
+                    fill[tau][ph][dut] = 0;
+                    done[tau][ph][dut]++;
+                }
+            }
+        }
+    }
+    
+    // Allan deviation (0 until there are two clusters of this size)
+    double Deviation(int tau, int dut) const
+    {
+        return (terms[tau][dut] > 0.0) ? sqrt(squares[tau][dut] / (2.0 * terms[tau][dut])) : 0.0;
+    }
+} AllanStats;
+
+//-----------------------------------------------------------------------------
+//  P2Quantile: P-square estimate (Jain & Chlamtac) of the p quantile of every
+//  site, from 5 markers per site instead of every sample
+typedef struct P2Quantile
+{
+    double p;
+    double n[TOOL_MAX_DUT];                 // samples taken
+    double q[5][TOOL_MAX_DUT];              // marker heights
+    double pos[5][TOOL_MAX_DUT];            // marker positions
+    double want[5][TOOL_MAX_DUT];           // desired marker positions
+    double step[5];                         // desired position increments
+    
+    void Clear(double p_in)
+    {
+        p = p_in;
+        
+        step[0] = 0.0;
+        step[1] = p / 2.0;
+        step[2] = p;
+        step[3] = (1.0 + p) / 2.0;
+        step[4] = 1.0;
+        
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+            n[dut] = 0.0;
+    }
+    
+    // add one sample x[TOOL_MAX_DUT] for the sites with weight 1
+    void Add(const double* x, const double* weight)
+    {
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+        {
+            if (weight[dut] != 0.0)
+                Add(x[dut], dut);
+        }
+    }
+    
+    void Add(double x, int dut)
+    {
+        int k, i;
+        
+        // the first 5 samples are the markers (kept sorted)
+        if (n[dut] < 5.0)
+        {
+            for (i = (int)n[dut]; (i > 0) && (q[i - 1][dut] > x); i--)
+                q[i][dut] = q[i - 1][dut];
+            q[i][dut] = x;
+            
+            n[dut] += 1.0;
+            
+            if (n[dut] == 5.0)
+            {
+                for (i = 0; i < 5; i++)
+                    pos[i][dut] = i + 1;
+                
+                want[0][dut] = 1.0;
+                want[1][dut] = 1.0 + (2.0 * p);
+                want[2][dut] = 1.0 + (4.0 * p);
+                want[3][dut] = 3.0 + (2.0 * p);
+                want[4][dut] = 5.0;
+            }
+            return;
+        }
+        
+        // cell the sample falls in (stretching the end markers)
+        if (x < q[0][dut])
+        {
+            q[0][dut] = x;
+            k = 0;
+        }
+        else if (x >= q[4][dut])
+        {
+            q[4][dut] = x;
+            k = 3;
+        }
+        else
+        {
+            for (k = 0; x >= q[k + 1][dut]; k++)
+                ;
+        }
+        
+        for (i = k + 1; i < 5; i++)
+            pos[i][dut] += 1.0;
+        for (i = 0; i < 5; i++)
+            want[i][dut] += step[i];
+        
+        n[dut] += 1.0;
+        
+        // move the middle markers that are off by a position or more
+        for (i = 1; i < 4; i++)
+        {
+            double d = want[i][dut] - pos[i][dut];
+            
+            if ( ((d >= 1.0) && (pos[i + 1][dut] - pos[i][dut] > 1.0)) ||
+                 ((d <= -1.0) && (pos[i - 1][dut] - pos[i][dut] < -1.0)) )
+            {
+                int s = (d > 0.0) ? 1 : -1;
+                double h = Parabolic(i, s, dut);
+                
+                if ( (q[i - 1][dut] < h) && (h < q[i + 1][dut]) )
+                    q[i][dut] = h;
+                else
+                    q[i][dut] += s * (q[i + s][dut] - q[i][dut]) / (pos[i + s][dut] - pos[i][dut]);
+                
+                pos[i][dut] += s;
+            }
+        }
+    }
+    
+    // piecewise-parabolic height of marker i moved by s
+    double Parabolic(int i, int s, int dut) const
+    {
+        double below = pos[i][dut] - pos[i - 1][dut];
+        double above = pos[i + 1][dut] - pos[i][dut];
+        
+        return q[i][dut] + (s / (pos[i + 1][dut] - pos[i - 1][dut])) *
+            ( ((below + s) * (q[i + 1][dut] - q[i][dut]) / above) +
+              ((above - s) * (q[i][dut] - q[i - 1][dut]) / below) );
+    }
+    
+    // estimate (from the sorted samples until there are 5)
+    double Value(int dut) const
+    {
+        if (n[dut] >= 5.0)
+            return q[2][dut];
+        if (n[dut] == 0.0)
+            return 0.0;
+        
+        return q[(int)((p * (n[dut] - 1.0)) + 0.5)][dut];
+    }
+} P2Quantile;
+
+//-----------------------------------------------------------------------------
+//  SpikeFilter: rejects samples further than limit robust sigmas (MAD based,
+//  at least 1 count since outputs are whole counts) from the running median
+//  of each site.  Every sample goes into the median and MAD estimates, so a
+//  spike can't hide the ones after it.
+typedef struct SpikeFilter
+{
+    double limit;                           // robust sigmas (0 = off)
+    P2Quantile median;
+    P2Quantile mad;                         // median of |x - median|
+    int rejected[TOOL_MAX_DUT];
+    
+    void Clear(double limit_in)
+    {
+        limit = limit_in;
+        median.Clear(0.5);
+        mad.Clear(0.5);
+        
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+            rejected[dut] = 0;
+    }
+    
+    // keep[TOOL_MAX_DUT] is weight, with 0 for the sites where x is a spike
+    void Check(const int* x, const double* weight, double* keep)
+    {
+        double value[TOOL_MAX_DUT];
+        double deviation[TOOL_MAX_DUT];
+        
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+        {
+            value[dut] = (double)x[dut];
+            deviation[dut] = fabs(value[dut] - median.Value(dut));
+            keep[dut] = weight[dut];
+            
+            if ( (limit > 0.0) && (weight[dut] != 0.0) && (median.n[dut] >= SPIKE_WARMUP) &&
+                 (deviation[dut] > limit * MAD_TO_SIGMA * max(mad.Value(dut), 1.0)) )
+            {
+                keep[dut] = 0.0;
+                rejected[dut]++;
+            }
+        }
+        
+        median.Add(value, weight);
+        mad.Add(deviation, weight);
+    }
+} SpikeFilter;
+
+#endif
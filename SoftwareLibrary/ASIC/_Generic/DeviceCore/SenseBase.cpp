@@ -14,6 +14,12 @@
 CSenseBase::CSenseBase(void)
 {
     this->CurrODR = 0.0;
+    this->SampleRate = 0.0;
+    this->SpikeLimit = 0.0;
+    this->MeanTolerance = 0.0;
+    this->StDevTolerance = 0.0;
+    this->RemoveCommonMode = false;
+    this->Allan = NULL;
 }
 
 /******************************************************************************
@@ -22,77 +28,590 @@ CSenseBase::CSenseBase(void)
 ******************************************************************************/
 CSenseBase::~CSenseBase(void)
 {
+    delete [] this->Allan;
 }
 
 /******************************************************************************
     Name:   SampleOutputs
     Desc:   Read Sense Element outputs multiple times, collecting average and
-            standard deviation for each DUT
+            standard deviation for each DUT: avg[MAX_NUM_AXES][TOOL_MAX_DUT]
+            and st_dev[MAX_NUM_AXES][TOOL_MAX_DUT]
             
-            Currently in development
+            The statistics are updated as each block of samples comes in, so
+            there is no limit on count.  With a spike limit set, spikes are
+            left out of every statistic (see SetSpikeLimit).  With a
+            tolerance set, each site stops being read after the block that
+            brings it within tolerance (see SetTolerance and SampleCounts).
+            With the common mode removed, the same statistics without it
+            are kept as well (see SetCommonMode and SampleCorrected).  With
+            the spectrum started, every block also goes to its workers and
+            every site is read for all count samples (see NoiseDensity); the
+            spectrum of the last call is cleared first, which waits for its
+            workers.  The rate the samples were read at is measured for it
+            (see GetSampleRate).
+            With the Allan deviation started, it is cleared and every sample
+            is added to it in the same way (see AllanDeviation).
+            
+            A site with no samples on an axis (nothing read, or every sample
+            a spike) keeps its avg and st_dev for that axis as they were,
+            and raises an error.
             
 ******************************************************************************/
 void CSenseBase::SampleOutputs(int count, int timeout, double* avg, double* st_dev, int output_type, word* listDut)
 {
     DBGTrace("--> CSenseBase::SampleOutputs");
     
-    int dut;
-    byte fromDut[MAX_NUM_AXES][APP_MAX_ADDR][TOOL_MAX_DUT];
-    int int_output[APP_MAX_SAMPLES][MAX_NUM_AXES][TOOL_MAX_DUT];
-    double average[MAX_NUM_AXES][TOOL_MAX_DUT];
-    double sigma[MAX_NUM_AXES][TOOL_MAX_DUT];
-    //vector<int> SampleList[MAX_NUM_AXES][TOOL_MAX_DUT];
-    //vector<vector<int>> SampleList;
-    
-    memset(fromDut, 0x00, sizeof(fromDut));
+    int dut, block, num_axes, reading;
+    int empty = 0;
+    int taken = 0;
+    bool done, spectrum, allan, adapt;
+    String msg;
+    LARGE_INTEGER freq, first, last;
+    word readDut[TOOL_MAX_DUT + 1];
+    const ASICregister* reg[MAX_NUM_AXES];
+    int int_output[APP_SAMPLE_BLOCK][MAX_NUM_AXES][TOOL_MAX_DUT];
+    double weight[TOOL_MAX_DUT];
+    double keep[TOOL_MAX_DUT];
+    double value[TOOL_MAX_DUT];
+    double corrected[TOOL_MAX_DUT];
+    double common[TOOL_MAX_DUT];
+    const RunningStats* stats;
+    const double p[NUM_QUANTILES] = {0.01, 0.5, 0.99};
+    
     memset(int_output, 0, sizeof(int_output));
-    memset(average, 0, sizeof(average));
-    memset(sigma, 0, sizeof(sigma));
+    SampleWeights(listDut, weight);
+    this->Spectrum.Clear();
+    this->SampleRate = 0.0;
     
-    // TODO: read multiple output types with one function call?
-    switch(output_type)
+    // the spectrum and the Allan deviation need every site read at the
+    // same rate all the way through, so no site stops early
+    spectrum = this->Spectrum.IsStarted();
+    allan = (this->Allan != NULL);
+    adapt = ( (this->MeanTolerance > 0.0) || (this->StDevTolerance > 0.0) ) && !spectrum && !allan;
+    
+    // samples are missed between calls, so the clusters can't run on from
+    // the last one
+    if (allan)
     {
-    case SENSE_ACCEL:
+        for (int dim = X; dim < MAX_NUM_AXES; dim++)
+            this->Allan[dim].Clear();
+    }
+    
+    reading = 0;
+    for (int d = 0; listDut[d] != 0; d++)
+        readDut[reading++] = listDut[d];
+    readDut[reading] = 0;
+    
+    for (int dim = X; dim < MAX_NUM_AXES; dim++)
+    {
+        this->Stats[dim].Clear();
+        this->Corrected[dim].Clear();
+        this->Spikes[dim].Clear(this->SpikeLimit);
+        for (int q = 0; q < NUM_QUANTILES; q++)
+            this->Quantiles[q][dim].Clear(p[q]);
+    }
+    
+    // TODO: read multiple output types with one function call?
+    num_axes = this->OutputRegisters(output_type, reg);
+    if ( (num_axes == 0) || (count <= 0) )
+        return;
+    
+    // the samples are polled back to back, so they are evenly spaced at
+    // the rate the tool reads them (the statistics between blocks take
+    // little time next to the reads)
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&first);
+    
+    // The action happens here
+    for (int sample = 0; sample < count; sample += block)
     {
-        ASICregister reg[MAX_NUM_AXES] = {this->REG_ACCEL_OUT_X, 
-                                      this->REG_ACCEL_OUT_Y,
-                                      this->REG_ACCEL_OUT_Z};
+        // get a block of samples
+        block = this->ReadBlock(reg, num_axes, count - sample, &int_output[0][0][0], readDut);
+        if (block == 0)
+            break;
+        taken += block;
         
-        // The action happens here
-        for (int sample = 0; sample < count; sample++)
+        // the workers take the spectrum while the next block is read
+        if (spectrum)
+            this->Spectrum.Add(&int_output[0][0][0], block, num_axes, weight);
+        
+        // update the statistics of every site
+        for (int s = 0; s < block; s++)
         {
-            for (int dim = X; dim < MAX_NUM_AXES; dim++)
+            for (int dim = X; dim < num_axes; dim++)
             {
-                // get a sample
-                this->GetRegister(reg[dim], &fromDut[dim][0][0], listDut);
+                this->Spikes[dim].Check(int_output[s][dim], weight, keep);
+                
+                // spikes too, so the clusters stay evenly spaced in time
+                if (allan)
+                    this->Allan[dim].Add(int_output[s][dim], weight);
                 
-                // convert
-                reg[dim].ConvertToInt(&fromDut[dim][0][0], &int_output[sample][dim][0], listDut);
+                memset(common, 0, sizeof(common));
+                if (this->RemoveCommonMode)
+                    CommonMode(int_output[s][dim], this->Corrected[dim], keep, common);
                 
-                // sum for average
-                for (int d = 0; listDut[d] != 0; d++)
+                this->Stats[dim].Add(int_output[s][dim], keep);
+                
+                for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
                 {
-                    dut = listDut[d] - 1;
-                    average[dim][dut] += (double)(int_output[sample][dim][dut]);
+                    value[dut] = (double)int_output[s][dim][dut];
+                    corrected[dut] = value[dut] - common[dut];
                 }
+                this->Corrected[dim].Add(corrected, keep);
+                
+                for (int q = 0; q < NUM_QUANTILES; q++)
+                    this->Quantiles[q][dim].Add(value, keep);
             }
         }
         
-        // average
-        
-        
-        // standard deviation
+        if (!adapt)
+            continue;
         
+        // drop the sites within tolerance on every axis from the reads (on
+        // the noise of each site alone when the common mode is taken out)
+        stats = this->RemoveCommonMode ? this->Corrected : this->Stats;
+        reading = 0;
+        for (int d = 0; readDut[d] != 0; d++)
+        {
+            dut = readDut[d] - 1;
+            done = (stats[X].n[dut] >= ADAPT_MIN_SAMPLES);
+            
+            for (int dim = X; dim < num_axes; dim++)
+            {
+                if ( (this->MeanTolerance > 0.0) && (stats[dim].MeanInterval(dut) > this->MeanTolerance) )
+                    done = false;
+                if ( (this->StDevTolerance > 0.0) && (stats[dim].StDevInterval(dut) > this->StDevTolerance) )
+                    done = false;
+            }
+            
+            if (done)
+                weight[dut] = 0.0;
+            else
+                readDut[reading++] = readDut[d];
+        }
+        readDut[reading] = 0;
         
-        // median
+        if (reading == 0)
+            break;
+    }
+    
+    QueryPerformanceCounter(&last);
+    if ( (taken > 0) && (last.QuadPart > first.QuadPart) )
+        this->SampleRate = taken * (double)freq.QuadPart / (double)(last.QuadPart - first.QuadPart);
+    
+    // store results
+    for (int dim = X; dim < num_axes; dim++)
+    {
+        for (int d = 0; listDut[d] != 0; d++)
+        {
+            dut = listDut[d] - 1;
+            if (this->Stats[dim].n[dut] == 0.0)
+            {
+                empty++;
+                continue;
+            }
+            
+            avg[(dim * TOOL_MAX_DUT) + dut] = this->Stats[dim].mean[dut];
+            st_dev[(dim * TOOL_MAX_DUT) + dut] = this->Stats[dim].StDev(dut);
+        }
+    }
+    
+    if (empty > 0)
+    {
+        sprintf(msg, "No samples for %i site axes", empty);
+        ERRChk(ERROR_RUN, msg, "CSenseBase::SampleOutputs", false);
+    }
+}
+
+/******************************************************************************
+    Name:   WaitForSamples
+    Desc:   Waits for num new output samples on every site: the outputs of
+            the sites still waiting are read in one burst until they have
+            changed num times, dropping each site as soon as it has.  Reads
+            at least once, gives up after timeout ms (warning), and returns
+            the number of sites still waiting (an output that doesn't change
+            at all looks not ready).
+******************************************************************************/
+int CSenseBase::WaitForSamples(int output_type, int num, int timeout, word* listDut)
+{
+    DBGTrace("--> CSenseBase::WaitForSamples");
+    
+    String msg;
+    byte low;
+    int size, dut;
+    int waiting = 0;
+    int seen[TOOL_MAX_DUT];
+    word waitDut[TOOL_MAX_DUT + 1];
+    const ASICregister* reg[MAX_NUM_AXES];
+    byte last[MAX_NUM_AXES * APP_MAX_ADDR][TOOL_MAX_DUT];
+    byte now[MAX_NUM_AXES * APP_MAX_ADDR][TOOL_MAX_DUT];
+    dword start = GetTickCount();
+    
+    if (this->OutputRegisters(output_type, reg) == 0)
+        return 0;
+    
+    size = this->OutputSpan(reg, MAX_NUM_AXES, &low);
+    if (size == 0)
+        return 0;
+    
+    for (int d = 0; listDut[d] != 0; d++)
+        waitDut[waiting++] = listDut[d];
+    waitDut[waiting] = 0;
+    
+    memset(seen, 0, sizeof(seen));
+    memset(last, 0, sizeof(last));
+    this->GetByte(reg[X]->page, low, size, &last[0][0], waitDut, "OUTPUTS");
+    
+    while (waiting > 0)
+    {
+        memset(now, 0, sizeof(now));
+        this->GetByte(reg[X]->page, low, size, &now[0][0], waitDut, "OUTPUTS");
         
+        // a site has a new sample when any output byte changed
+        waiting = 0;
+        for (int d = 0; waitDut[d] != 0; d++)
+        {
+            dut = waitDut[d] - 1;
+            
+            for (int a = 0; a < size; a++)
+            {
+                if (now[a][dut] != last[a][dut])
+                {
+                    seen[dut]++;
+                    break;
+                }
+            }
+            
+            for (int a = 0; a < size; a++)
+                last[a][dut] = now[a][dut];
+            
+            if (seen[dut] < num)
+                waitDut[waiting++] = waitDut[d];
+        }
+        waitDut[waiting] = 0;
         
-        // store results
-        // TODO: do this properly
-        //int dataSize2D[APP_MAX_ARRAY_DIM + 1] = {3, TOOL_MAX_DUT, 0, 0};
-        //ARR2D(&int_output[0][0], int_type, dataSize2D, avg, listDut);
-        break;
+        if (GetTickCount() - start >= (dword)timeout)
+            break;
+    }
+    
+    if (waiting > 0)
+    {
+        sprintf(msg, "%i site(s) did not get %i new sample(s) within %i ms", waiting, num, timeout);
+        ERRWarn(msg);
     }
+    
+    return waiting;
+}
+
+/******************************************************************************
+    Name:   SampleRange
+    Desc:   Lowest and highest output of each axis of each DUT from the last
+            SampleOutputs: [MAX_NUM_AXES][TOOL_MAX_DUT] (0 for a site with
+            no samples, see SampleCounts)
+******************************************************************************/
+void CSenseBase::SampleRange(int* lowest, int* highest, word* listDut)
+{
+    DBGTrace("--> CSenseBase::SampleRange");
+    
+    int dut;
+    
+    for (int dim = X; dim < MAX_NUM_AXES; dim++)
+    {
+        for (int d = 0; listDut[d] != 0; d++)
+        {
+            dut = listDut[d] - 1;
+            lowest[(dim * TOOL_MAX_DUT) + dut] = this->Stats[dim].Lowest(dut);
+            highest[(dim * TOOL_MAX_DUT) + dut] = this->Stats[dim].Highest(dut);
+        }
+    }
+}
+
+/******************************************************************************
+    Name:   SampleQuantiles
+    Desc:   1st percentile, median and 99th percentile of each axis of each
+            DUT from the last SampleOutputs (estimates): [MAX_NUM_AXES][TOOL_MAX_DUT]
+******************************************************************************/
+void CSenseBase::SampleQuantiles(double* p1, double* median, double* p99, word* listDut)
+{
+    DBGTrace("--> CSenseBase::SampleQuantiles");
+    
+    int dut, index;
+    
+    for (int dim = X; dim < MAX_NUM_AXES; dim++)
+    {
+        for (int d = 0; listDut[d] != 0; d++)
+        {
+            dut = listDut[d] - 1;
+            index = (dim * TOOL_MAX_DUT) + dut;
+            
+            p1[index] = this->Quantiles[QUANTILE_P1][dim].Value(dut);
+            median[index] = this->Quantiles[QUANTILE_MEDIAN][dim].Value(dut);
+            p99[index] = this->Quantiles[QUANTILE_P99][dim].Value(dut);
+        }
+    }
+}
+
+/******************************************************************************
+    Name:   SampleSpikes
+    Desc:   Samples rejected as spikes for each axis of each DUT in the last
+            SampleOutputs: [MAX_NUM_AXES][TOOL_MAX_DUT]
+******************************************************************************/
+void CSenseBase::SampleSpikes(int* rejected, word* listDut)
+{
+    DBGTrace("--> CSenseBase::SampleSpikes");
+    
+    int dut;
+    
+    for (int dim = X; dim < MAX_NUM_AXES; dim++)
+    {
+        for (int d = 0; listDut[d] != 0; d++)
+        {
+            dut = listDut[d] - 1;
+            rejected[(dim * TOOL_MAX_DUT) + dut] = this->Spikes[dim].rejected[dut];
+        }
+    }
+}
+
+/******************************************************************************
+    Name:   SampleCounts
+    Desc:   Samples in the statistics of each axis of each DUT from the last
+            SampleOutputs (fewer than count for the sites that got within
+            tolerance early): [MAX_NUM_AXES][TOOL_MAX_DUT]
+******************************************************************************/
+void CSenseBase::SampleCounts(int* count, word* listDut)
+{
+    DBGTrace("--> CSenseBase::SampleCounts");
+    
+    int dut;
+    
+    for (int dim = X; dim < MAX_NUM_AXES; dim++)
+    {
+        for (int d = 0; listDut[d] != 0; d++)
+        {
+            dut = listDut[d] - 1;
+            count[(dim * TOOL_MAX_DUT) + dut] = (int)this->Stats[dim].n[dut];
+        }
+    }
+}
+
+/******************************************************************************
+    Name:   NoiseDensity
+    Desc:   Noise density of each axis of each DUT between f_low and f_high
+            (Hz) from the last SampleOutputs, once its spectrum is done:
+            density[MAX_NUM_AXES][TOOL_MAX_DUT] in counts/rtHz (divide by
+            the sensitivity in counts/ug for ug/rtHz)
+            
+            The samples are spaced at the measured sample rate.  Polled
+            faster than the ODR, each output is read more than once, so the
+            band is cut to half the lower of the two (with a warning); the
+            ODR is known once a state has set it.
+            NOTE: needs StartSpectrum before SampleOutputs
+******************************************************************************/
+void CSenseBase::NoiseDensity(double f_low, double f_high, double* density, word* listDut)
+{
+    DBGTrace("--> CSenseBase::NoiseDensity");
+    
+    String msg;
+    double limit;
+    
+    if ( (!this->Spectrum.IsStarted()) || (this->SampleRate <= 0.0) )
+    {
+        ERRChk(ERROR_RUN, "No spectrum to take the noise density from", "CSenseBase::NoiseDensity", false);
+        return;
+    }
+    
+    limit = this->SampleRate / 2.0;
+    if (this->CurrODR > 0.0)
+        limit = min(limit, this->CurrODR / 2.0);
+    
+    if (f_high > limit)
+    {
+        sprintf(msg, "Noise density band cut to %.1f Hz (half the sample rate or ODR)", limit);
+        ERRWarn(msg);
+        f_high = limit;
+    }
+    
+    for (int dim = X; dim < MAX_NUM_AXES; dim++)
+        this->Spectrum.Density(dim, this->SampleRate, f_low, f_high, &density[dim * TOOL_MAX_DUT], listDut);
+}
+
+/******************************************************************************
+    Name:   StartAllan
+    Desc:   Takes the Allan deviation of the samples from each SampleOutputs
+            (from the next one) until StopAllan.  Its clusters can't run
+            across SampleOutputs calls (the samples in between are missed),
+            so each call starts it over: take as many samples in one call
+            as the longest cluster time needs.
+******************************************************************************/
+void CSenseBase::StartAllan(void)
+{
+    DBGTrace("--> CSenseBase::StartAllan");
+    
+    if (this->Allan == NULL)
+        this->Allan = new AllanStats[MAX_NUM_AXES];
+    
+    for (int dim = X; dim < MAX_NUM_AXES; dim++)
+        this->Allan[dim].Clear();
+}
+
+/******************************************************************************
+    Name:   StopAllan
+    Desc:   Stops the Allan deviation and frees it
+******************************************************************************/
+void CSenseBase::StopAllan(void)
+{
+    DBGTrace("--> CSenseBase::StopAllan");
+    
+    delete [] this->Allan;
+    this->Allan = NULL;
+}
+
+/******************************************************************************
+    Name:   AllanDeviation
+    Desc:   Overlapping Allan deviation of each axis of each DUT from the
+            last SampleOutputs, at cluster times tau[ALLAN_MAX_TAUS] (s) of
+            1, 2, 4 .. samples at the measured sample rate:
+            adev[MAX_NUM_AXES][ALLAN_MAX_TAUS][TOOL_MAX_DUT] in counts (0
+            until there are two clusters of that size).  Polled faster than
+            the ODR, the cluster times shorter than an ODR period hold
+            repeats of one output and mean nothing.  See AllanNoise for the
+            noise terms.
+            NOTE: needs StartAllan before SampleOutputs
+******************************************************************************/
+void CSenseBase::AllanDeviation(double* tau, double* adev, word* listDut)
+{
+    DBGTrace("--> CSenseBase::AllanDeviation");
+    
+    int dut;
+    
+    if ( (this->Allan == NULL) || (this->SampleRate <= 0.0) )
+    {
+        ERRChk(ERROR_RUN, "No samples to take the Allan deviation of", "CSenseBase::AllanDeviation", false);
+        return;
+    }
+    
+    for (int t = 0; t < ALLAN_MAX_TAUS; t++)
+        tau[t] = AllanStats::Size(t) / this->SampleRate;
+    
+    for (int dim = X; dim < MAX_NUM_AXES; dim++)
+    {
+        for (int t = 0; t < ALLAN_MAX_TAUS; t++)
+        {
+            for (int d = 0; listDut[d] != 0; d++)
+            {
+                dut = listDut[d] - 1;
+                adev[(((dim * ALLAN_MAX_TAUS) + t) * TOOL_MAX_DUT) + dut] = this->Allan[dim].Deviation(t, dut);
+            }
+        }
+    }
+}
+
+/******************************************************************************
+    Name:   AllanNoise
+    Desc:   Noise terms of each axis of each DUT from the Allan deviation
+            of the last SampleOutputs: [MAX_NUM_AXES][TOOL_MAX_DUT]
+              - bias: the floor of the curve (counts), the bias
+                instability (divide by 0.664 for the flicker coefficient)
+              - walk: where the -1/2 slope of the curve is at tau = 1 s
+                (counts/rtHz, the white noise density), taken at the first
+                pair of cluster times that falls at close to that slope
+            0 where the curve has no point (or no -1/2 slope).  Cluster
+            times shorter than an ODR period are left out once a state has
+            set the ODR.
+******************************************************************************/
+void CSenseBase::AllanNoise(double* bias, double* walk, word* listDut)
+{
+    DBGTrace("--> CSenseBase::AllanNoise");
+    
+    int dut, index;
+    double dev, next, slope, tau;
+    
+    if ( (this->Allan == NULL) || (this->SampleRate <= 0.0) )
+    {
+        ERRChk(ERROR_RUN, "No samples to take the Allan deviation of", "CSenseBase::AllanNoise", false);
+        return;
+    }
+    
+    for (int dim = X; dim < MAX_NUM_AXES; dim++)
+    {
+        for (int d = 0; listDut[d] != 0; d++)
+        {
+            dut = listDut[d] - 1;
+            index = (dim * TOOL_MAX_DUT) + dut;
+            bias[index] = 0.0;
+            walk[index] = 0.0;
+            
+            for (int t = 0; t < ALLAN_MAX_TAUS; t++)
+            {
+                // repeats of one output, polled faster than the ODR
+                tau = AllanStats::Size(t) / this->SampleRate;
+                if ( (this->CurrODR > 0.0) && (tau < 1.0 / this->CurrODR) )
+                    continue;
+                
+                dev = this->Allan[dim].Deviation(t, dut);
+                if (dev <= 0.0)
+                    break;
+                
+                if ( (bias[index] == 0.0) || (dev < bias[index]) )
+                    bias[index] = dev;
+                
+                // sigma = N / sqrt(tau) on the -1/2 slope
+                next = (t + 1 < ALLAN_MAX_TAUS) ? this->Allan[dim].Deviation(t + 1, dut) : 0.0;
+                if ( (walk[index] == 0.0) && (next > 0.0) )
+                {
+                    slope = log(next / dev) / log(2.0);
+                    if ( (slope > -0.75) && (slope < -0.25) )
+                        walk[index] = dev * sqrt(tau);
+                }
+            }
+        }
+    }
+}
+
+/******************************************************************************
+    Name:   SampleCorrected
+    Desc:   Average and standard deviation of each axis of each DUT from the
+            last SampleOutputs with the common mode of all sites taken out
+            (the same as SampleOutputs gave if it wasn't):
+            avg[MAX_NUM_AXES][TOOL_MAX_DUT] and st_dev[MAX_NUM_AXES][TOOL_MAX_DUT]
+            Only the variation of the common mode can be taken out (its
+            average is the same for every site), so avg is the one from
+            SampleOutputs.
+******************************************************************************/
+void CSenseBase::SampleCorrected(double* avg, double* st_dev, word* listDut)
+{
+    DBGTrace("--> CSenseBase::SampleCorrected");
+    
+    int dut;
+    
+    for (int dim = X; dim < MAX_NUM_AXES; dim++)
+    {
+        for (int d = 0; listDut[d] != 0; d++)
+        {
+            dut = listDut[d] - 1;
+            avg[(dim * TOOL_MAX_DUT) + dut] = this->Stats[dim].mean[dut];
+            st_dev[(dim * TOOL_MAX_DUT) + dut] = this->Corrected[dim].StDev(dut);
+        }
+    }
+}
+
+/******************************************************************************
+    Name:   OutputRegisters
+    Desc:   Gets the output registers of each axis for output_type, returns
+            the number of axes (0 if output_type can't be sampled)
+******************************************************************************/
+int CSenseBase::OutputRegisters(int output_type, const ASICregister** reg)
+{
+    DBGTrace("--> CSenseBase::OutputRegisters");
+    
+    switch(output_type)
+    {
+    case SENSE_ACCEL:
+        reg[X] = &this->REG_ACCEL_OUT_X;
+        reg[Y] = &this->REG_ACCEL_OUT_Y;
+        reg[Z] = &this->REG_ACCEL_OUT_Z;
+        return MAX_NUM_AXES;
+        
     case SENSE_GYRO:
         // TODO: implement
         
@@ -112,6 +631,91 @@ void CSenseBase::SampleOutputs(int count, int timeout, double* avg, double* st_d
         ERRChk(ERROR_ASIC_SPECIFIC, "Invalid output_type chosen when attempting to Sample", "CSenseBase::Sample", false);
         break;
     }
+    
+    return 0;
+}
+
+/******************************************************************************
+    Name:   OutputSpan
+    Desc:   Gets the lowest address of the output registers of every axis
+            (they must be on one page, close together), returns the number of
+            bytes from there to the highest (0 if they can't be read at once)
+******************************************************************************/
+int CSenseBase::OutputSpan(const ASICregister* const* reg, int num_axes, byte* low)
+{
+    byte high = 0;
+    int size;
+    
+    *low = ADDR_INVALID;
+    
+    for (int dim = X; dim < num_axes; dim++)
+    {
+        for (int a = 0; a < reg[dim]->num_registers; a++)
+        {
+            if (reg[dim]->Address(a) != ADDR_INVALID)
+            {
+                *low = min(*low, reg[dim]->Address(a));
+                high = max(high, reg[dim]->Address(a));
+            }
+        }
+        
+        if (reg[dim]->page != reg[X]->page)
+        {
+            ERRChk(ERROR_ASIC_SPECIFIC, "Output registers must be on one page", "CSenseBase::OutputSpan", YES);
+            return 0;
+        }
+    }
+    
+    size = (high - *low) + 1;
+    if ( (*low == ADDR_INVALID) || (size > MAX_NUM_AXES * APP_MAX_ADDR) )
+    {
+        ERRChk(ERROR_ASIC_SPECIFIC, "Output registers can't be read in one burst", "CSenseBase::OutputSpan", YES);
+        return 0;
+    }
+    
+    return size;
+}
+
+/******************************************************************************
+    Name:   ReadBlock
+    Desc:   Reads the next block of samples, returns the number read
+******************************************************************************/
+int CSenseBase::ReadBlock(const ASICregister* const* reg, int num_axes, int count, int* output, word* listDut)
+{
+    count = min(count, APP_SAMPLE_BLOCK);
+    
+    this->ReadSamples(reg, num_axes, count, output, listDut);
+    
+    return count;
+}
+
+/******************************************************************************
+    Name:   ReadSamples
+    Desc:   Reads count samples with one burst per sample covering the
+            output registers of every axis, then converts all of them at
+            once.  output is [count][MAX_NUM_AXES][TOOL_MAX_DUT]
+******************************************************************************/
+void CSenseBase::ReadSamples(const ASICregister* const* reg, int num_axes, int count, int* output, word* listDut)
+{
+    DBGTrace("--> CSenseBase::ReadSamples");
+    
+    byte low;
+    int size;
+    byte raw[APP_SAMPLE_BLOCK][MAX_NUM_AXES * APP_MAX_ADDR][TOOL_MAX_DUT];
+    
+    size = this->OutputSpan(reg, num_axes, &low);
+    if ( (size == 0) || (count > APP_SAMPLE_BLOCK) )
+        return;
+    
+    memset(raw, 0, count * sizeof(raw[0]));
+    
+    // one burst per sample, for all sites
+    for (int s = 0; s < count; s++)
+        this->GetByte(reg[X]->page, low, size, &raw[s][0][0], listDut, "OUTPUTS");
+    
+    // convert every sample of each axis at once
+    for (int dim = X; dim < num_axes; dim++)
+        reg[dim]->ConvertBursts(&raw[0][0][0], low, MAX_NUM_AXES * APP_MAX_ADDR, count, &output[dim * TOOL_MAX_DUT], MAX_NUM_AXES * TOOL_MAX_DUT, listDut);
 }
 
 /******************************************************************************
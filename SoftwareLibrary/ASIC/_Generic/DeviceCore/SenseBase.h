@@ -9,6 +9,8 @@
 #define _SENSE_BASE_H_
 
 #include "DeviceBase.h"
+#include "SampleStats.h"
+#include "Spectrum.h"
 
 //-----------------------------------------------------------------------------
 //  SenseBase class definition
@@ -16,6 +18,36 @@ class CSenseBase : public CDeviceBase
 {
 protected:
     double CurrODR;
+    double SampleRate;                      // samples/s read in the last
+                                            // SampleOutputs (measured)
+    
+    // statistics of each axis from the last SampleOutputs
+    RunningStats Stats[MAX_NUM_AXES];
+    P2Quantile Quantiles[NUM_QUANTILES][MAX_NUM_AXES];
+    SpikeFilter Spikes[MAX_NUM_AXES];
+    double SpikeLimit;
+    double MeanTolerance;
+    double StDevTolerance;
+    
+    // statistics with the common mode of all sites taken out
+    RunningStats Corrected[MAX_NUM_AXES];
+    bool RemoveCommonMode;
+    
+    // noise spectrum of every axis of every site (once started)
+    CSpectrum Spectrum;
+    
+    // Allan deviation of every axis of every site, [MAX_NUM_AXES] (once
+    // started, NULL = off)
+    AllanStats* Allan;
+    
+    // output registers for an output_type (returns the number of axes)
+    int OutputRegisters(int output_type, const ASICregister** reg);
+    int OutputSpan(const ASICregister* const* reg, int num_axes, byte* low);
+    
+    // read up to count (and APP_SAMPLE_BLOCK) samples of every axis into
+    // output[count][MAX_NUM_AXES][TOOL_MAX_DUT], returns the number read
+    int ReadBlock(const ASICregister* const* reg, int num_axes, int count, int* output, word* listDut);
+    void ReadSamples(const ASICregister* const* reg, int num_axes, int count, int* output, word* listDut);
     
     //void ReadOutputs(ASICregister reg, int output_type);  // TODO: determine inputs
     //void Decode(byte* raw, double* out, word* listDut);
@@ -25,6 +57,45 @@ public:
     ~CSenseBase(void);
     
     void SampleOutputs(int count, int timeout, double* avg, double* st_dev, int output_type, word* listDut);
+    int WaitForSamples(int output_type, int num, int timeout, word* listDut);
+    void SampleRange(int* lowest, int* highest, word* listDut);
+    void SampleQuantiles(double* p1, double* median, double* p99, word* listDut);
+    void SampleSpikes(int* rejected, word* listDut);
+    void SampleCounts(int* count, word* listDut);
+    void SampleCorrected(double* avg, double* st_dev, word* listDut);
+    
+    // reject samples more than limit robust sigmas from the median (0 = off)
+    void SetSpikeLimit(double limit) { this->SpikeLimit = limit; }
+    
+    // stop sampling each site once the confidence intervals on the mean
+    // and standard deviation of every axis are within these (counts, 0 =
+    // don't care), so count is only the most samples (both 0 = off, and
+    // off while the spectrum or Allan deviation is taken)
+    void SetTolerance(double mean_tol, double st_dev_tol) { this->MeanTolerance = mean_tol; this->StDevTolerance = st_dev_tol; }
+    
+    // take the common mode out of each sample of each site (the median
+    // across the other sites) for SampleCorrected
+    void SetCommonMode(bool remove) { this->RemoveCommonMode = remove; }
+    
+    // ODR the part was last set to (Hz), the most the outputs change at
+    void SetCurrODR(double odr) { this->CurrODR = odr; }
+    
+    // samples/s of every site in the last SampleOutputs (polled back to
+    // back, measured; 0 before the first)
+    double GetSampleRate(void) { return this->SampleRate; }
+    
+    // Welch noise spectrum of the samples from SampleOutputs (segment is a
+    // power of 2), worked out by worker threads while sampling goes on
+    int StartSpectrum(int segment) { return this->Spectrum.Start(segment); }
+    void StopSpectrum(void) { this->Spectrum.Stop(); }
+    void NoiseDensity(double f_low, double f_high, double* density, word* listDut);
+    
+    // Allan deviation of the samples from each SampleOutputs until
+    // StopAllan, at the measured sample rate
+    void StartAllan(void);
+    void StopAllan(void);
+    void AllanDeviation(double* tau, double* adev, word* listDut);
+    void AllanNoise(double* bias, double* walk, word* listDut);
 };
 
 #endif
\ No newline at end of file
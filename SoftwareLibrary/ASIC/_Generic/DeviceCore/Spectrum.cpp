@@ -0,0 +1,353 @@
+/******************************************************************************
+    
+    File:   Spectrum.cpp
+    Desc:   Spectrum is a subcomponent in Level 1 of the design that works
+            out the noise spectrum of sampled outputs with Welch's method
+            (Hann windowed segments, 50% overlap, averaged periodograms).
+            The periodograms are worked out by worker threads while the
+            samples keep coming in.
+
+******************************************************************************/
+#include "Spectrum.h"
+
+/******************************************************************************
+    Name:   CSpectrum
+    Desc:   Default constructor
+******************************************************************************/
+CSpectrum::CSpectrum(void)
+{
+    this->size = 0;
+    this->window = NULL;
+    this->window_power = 0.0;
+    this->twiddle_re = NULL;
+    this->twiddle_im = NULL;
+    this->reverse = NULL;
+    
+    for (int s = 0; s < SPECTRUM_STREAMS; s++)
+    {
+        this->streams[s].segment = NULL;
+        this->streams[s].power = NULL;
+    }
+    
+    InitializeCriticalSection(&this->lock);
+}
+
+/******************************************************************************
+    Name:   ~CSpectrum
+    Desc:   Default destructor
+******************************************************************************/
+CSpectrum::~CSpectrum(void)
+{
+    this->Stop();
+    
+    DeleteCriticalSection(&this->lock);
+}
+
+/******************************************************************************
+    Name:   Start
+    Desc:   Sets up segments of segment samples (a power of 2), with the
+            window and FFT tables for them, and starts the workers
+******************************************************************************/
+int CSpectrum::Start(int segment)
+{
+    DBGTrace("--> CSpectrum::Start");
+    
+    int bits, half;
+    
+    this->Stop();
+    
+    if ( (segment < SPECTRUM_MIN_SEGMENT) || (segment > SPECTRUM_MAX_SEGMENT) || ((segment & (segment - 1)) != 0) )
+    {
+        ERRChk(ERROR_INIT, "Spectrum segment must be a power of 2", "CSpectrum::Start", false);
+        return ERROR_INIT;
+    }
+    
+    this->size = segment;
+    half = segment / 2;
+    
+    // periodic Hann window
+    this->window = new double[segment];
+    this->window_power = 0.0;
+    for (int n = 0; n < segment; n++)
+    {
+        this->window[n] = 0.5 - (0.5 * cos(2.0 * PI * n / segment));
+        this->window_power += this->window[n] * this->window[n];
+    }
+    
+    // the half size complex FFT uses every other twiddle
+    this->twiddle_re = new double[half];
+    this->twiddle_im = new double[half];
+    for (int k = 0; k < half; k++)
+    {
+        this->twiddle_re[k] = cos(2.0 * PI * k / segment);
+        this->twiddle_im[k] = sin(2.0 * PI * k / segment);
+    }
+    
+    for (bits = 0; (1 << bits) < half; bits++)
+        ;
+    this->reverse = new int[half];
+    for (int i = 0; i < half; i++)
+    {
+        this->reverse[i] = 0;
+        for (int b = 0; b < bits; b++)
+            this->reverse[i] |= ((i >> b) & 1) << (bits - 1 - b);
+    }
+    
+    for (int s = 0; s < SPECTRUM_STREAMS; s++)
+    {
+        this->streams[s].segment = new double[segment];
+        this->streams[s].power = new double[half + 1];
+    }
+    this->Clear();
+    
+    return this->Pool.Start(SPECTRUM_THREADS);
+}
+
+/******************************************************************************
+    Name:   Stop
+    Desc:   Waits for the workers and frees everything
+******************************************************************************/
+void CSpectrum::Stop(void)
+{
+    DBGTrace("--> CSpectrum::Stop");
+    
+    this->Pool.Stop();
+    
+    delete [] this->window;
+    delete [] this->twiddle_re;
+    delete [] this->twiddle_im;
+    delete [] this->reverse;
+    
+    this->window = NULL;
+    this->twiddle_re = NULL;
+    this->twiddle_im = NULL;
+    this->reverse = NULL;
+    
+    for (int s = 0; s < SPECTRUM_STREAMS; s++)
+    {
+        delete [] this->streams[s].segment;
+        delete [] this->streams[s].power;
+        this->streams[s].segment = NULL;
+        this->streams[s].power = NULL;
+    }
+    
+    this->size = 0;
+}
+
+/******************************************************************************
+    Name:   Clear
+    Desc:   Drops every sample and periodogram (after the workers finish)
+******************************************************************************/
+void CSpectrum::Clear(void)
+{
+    if (!this->IsStarted())
+        return;
+    
+    this->Pool.Wait();
+    
+    for (int s = 0; s < SPECTRUM_STREAMS; s++)
+    {
+        this->streams[s].fill = 0;
+        this->streams[s].segments = 0;
+        memset(this->streams[s].power, 0, ((this->size / 2) + 1) * sizeof(double));
+    }
+}
+
+/******************************************************************************
+    Name:   Add
+    Desc:   Adds count samples output[count][MAX_NUM_AXES][TOOL_MAX_DUT] of
+            the sites with weight 1.  Each time a stream has a whole segment
+            it goes to a worker, and the second half is kept as the start of
+            the next one.
+******************************************************************************/
+void CSpectrum::Add(const int* output, int count, int num_axes, const double* weight)
+{
+    int stream, half;
+    SpectrumStream* st;
+    SpectrumJob* job;
+    
+    if (!this->IsStarted())
+        return;
+    
+    half = this->size / 2;
+    
+    for (int dim = X; dim < num_axes; dim++)
+    {
+        for (int dut = 0; dut < TOOL_MAX_DUT; dut++)
+        {
+            if (weight[dut] == 0.0)
+                continue;
+            
+            stream = (dim * TOOL_MAX_DUT) + dut;
+            st = &this->streams[stream];
+            
+            for (int s = 0; s < count; s++)
+            {
+                st->segment[st->fill++] = (double)output[(((s * MAX_NUM_AXES) + dim) * TOOL_MAX_DUT) + dut];
+                if (st->fill < this->size)
+                    continue;
+                
+                // the segment and the worker's scratch (re, im, power)
+                job = new SpectrumJob;
+                job->owner = this;
+                job->stream = stream;
+                job->work = new double[(2 * this->size) + half + 1];
+                memcpy(job->work, st->segment, this->size * sizeof(double));
+                this->Pool.Submit(CSpectrum::Work, job);
+                
+                memmove(st->segment, &st->segment[half], half * sizeof(double));
+                st->fill = half;
+            }
+        }
+    }
+}
+
+/******************************************************************************
+    Name:   Density
+    Desc:   Noise density of axis of each DUT between f_low and f_high (Hz),
+            from the periodograms so far (after the workers finish), for
+            samples taken at rate (Hz): density[TOOL_MAX_DUT] in counts/rtHz
+            (0 with no whole segment or no frequency bin in the band)
+******************************************************************************/
+void CSpectrum::Density(int axis, double rate, double f_low, double f_high, double* density, word* listDut)
+{
+    DBGTrace("--> CSpectrum::Density");
+    
+    int dut, bins;
+    double sum, f;
+    const SpectrumStream* st;
+    
+    if (!this->IsStarted())
+        return;
+    
+    this->Pool.Wait();
+    
+    for (int d = 0; listDut[d] != 0; d++)
+    {
+        dut = listDut[d] - 1;
+        st = &this->streams[(axis * TOOL_MAX_DUT) + dut];
+        
+        // average one sided power spectral density over the band
+        sum = 0.0;
+        bins = 0;
+        for (int k = 0; k <= this->size / 2; k++)
+        {
+            f = k * rate / this->size;
+            if ( (f < f_low) || (f > f_high) )
+                continue;
+            
+            sum += st->power[k];
+            bins++;
+        }
+        
+        density[dut] = 0.0;
+        if ( (bins > 0) && (st->segments > 0) && (rate > 0.0) )
+            density[dut] = sqrt(sum / (bins * st->segments * rate));
+    }
+}
+
+/******************************************************************************
+    Name:   Work
+    Desc:   Worker thread job: one periodogram, then frees the job
+******************************************************************************/
+void CSpectrum::Work(void* job)
+{
+    SpectrumJob* sj = (SpectrumJob*) job;
+    
+    sj->owner->Periodogram(sj);
+    
+    delete [] sj->work;
+    delete sj;
+}
+
+/******************************************************************************
+    Name:   Periodogram
+    Desc:   Takes the mean out of the segment, windows it, and adds its one
+            sided periodogram (scaled by the window power, not yet by the
+            sample rate) to the stream
+******************************************************************************/
+void CSpectrum::Periodogram(SpectrumJob* job)
+{
+    int half = this->size / 2;
+    double mean = 0.0;
+    double* x = job->work;
+    double* re = &job->work[this->size];
+    double* im = &job->work[this->size + half];
+    double* power = &job->work[2 * this->size];
+    SpectrumStream* st = &this->streams[job->stream];
+    
+    for (int n = 0; n < this->size; n++)
+        mean += x[n];
+    mean /= this->size;
+    
+    for (int n = 0; n < this->size; n++)
+        x[n] = (x[n] - mean) * this->window[n];
+    
+    this->PowerOf(x, re, im, power);
+    
+    // every bin but DC and Nyquist counts twice in a one sided spectrum
+    EnterCriticalSection(&this->lock);
+    for (int k = 0; k <= half; k++)
+        st->power[k] += (((k == 0) || (k == half)) ? 1.0 : 2.0) * power[k] / this->window_power;
+    st->segments++;
+    LeaveCriticalSection(&this->lock);
+}
+
+/******************************************************************************
+    Name:   PowerOf
+    Desc:   Real FFT: the size real samples are packed as size / 2 complex
+            ones (even samples real, odd ones imaginary), transformed with
+            an in-place radix 2 FFT, and split back into the spectrum of
+            the real samples.  Real and imaginary parts are kept in separate
+            arrays so the loops vectorize.
+******************************************************************************/
+void CSpectrum::PowerOf(const double* x, double* re, double* im, double* power) const
+{
+    int half = this->size / 2;
+    int i, j, k, len, step, a, b;
+    double tr, ti;
+    
+    // pack, in bit reversed order
+    for (i = 0; i < half; i++)
+    {
+        j = this->reverse[i];
+        re[j] = x[2 * i];
+        im[j] = x[(2 * i) + 1];
+    }
+    
+    // butterflies, with twiddle exp(-2 pi i k / len) = twiddle[k * size / len]
+    for (len = 2; len <= half; len <<= 1)
+    {
+        step = this->size / len;
+        for (i = 0; i < half; i += len)
+        {
+            for (k = 0; k < len / 2; k++)
+            {
+                a = i + k;
+                b = a + (len / 2);
+                tr = (this->twiddle_re[k * step] * re[b]) + (this->twiddle_im[k * step] * im[b]);
+                ti = (this->twiddle_re[k * step] * im[b]) - (this->twiddle_im[k * step] * re[b]);
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+    
+    // split: X(k) = E(k) + exp(-2 pi i k / size) O(k), where E and O are the
+    // transforms of the even and odd samples
+    power[0] = (re[0] + im[0]) * (re[0] + im[0]);
+    power[half] = (re[0] - im[0]) * (re[0] - im[0]);
+    for (k = 1; k < half; k++)
+    {
+        double even_re = (re[k] + re[half - k]) / 2.0;
+        double even_im = (im[k] - im[half - k]) / 2.0;
+        double odd_re = (im[k] + im[half - k]) / 2.0;
+        double odd_im = (re[half - k] - re[k]) / 2.0;
+        
+        tr = even_re + (this->twiddle_re[k] * odd_re) + (this->twiddle_im[k] * odd_im);
+        ti = even_im + (this->twiddle_re[k] * odd_im) - (this->twiddle_im[k] * odd_re);
+        power[k] = (tr * tr) + (ti * ti);
+    }
+}
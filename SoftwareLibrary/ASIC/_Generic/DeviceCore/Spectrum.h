@@ -0,0 +1,90 @@
+/******************************************************************************
+    
+    File:   Spectrum.h
+    Desc:   Spectrum is a subcomponent in Level 1 of the design that works
+            out the noise spectrum of sampled outputs with Welch's method
+            (Hann windowed segments, 50% overlap, averaged periodograms).
+            The periodograms are worked out by worker threads while the
+            samples keep coming in.
+
+******************************************************************************/
+#ifndef _SPECTRUM_H_
+#define _SPECTRUM_H_
+
+#include "Defines.h"
+#include "WorkerPool.h"
+
+#define SPECTRUM_MIN_SEGMENT    8           // samples per segment (power of 2)
+#define SPECTRUM_MAX_SEGMENT    4096
+#define SPECTRUM_THREADS        2           // worker threads
+
+#ifndef PI
+    #define PI                  3.14159265358979323846
+#endif
+
+#define SPECTRUM_STREAMS        (MAX_NUM_AXES * TOOL_MAX_DUT)
+
+//-----------------------------------------------------------------------------
+//  SpectrumStream: samples of one axis of one site waiting for a whole
+//  segment, and the sum of its periodograms
+typedef struct SpectrumStream
+{
+    double* segment;                        // [size], fill of them so far
+    int fill;
+    double* power;                          // [size / 2 + 1]
+    int segments;                           // periodograms in power
+} SpectrumStream;
+
+class CSpectrum;
+
+//-----------------------------------------------------------------------------
+//  SpectrumJob: one segment for a worker (it frees the job)
+typedef struct SpectrumJob
+{
+    CSpectrum* owner;
+    int stream;
+    double* work;                           // the segment, then scratch
+} SpectrumJob;
+
+//-----------------------------------------------------------------------------
+//  Spectrum class definition
+class CSpectrum
+{
+private:
+    int size;                               // samples per segment (0 = off)
+    double* window;                         // [size] Hann window
+    double window_power;                    // sum of the window squared
+    double* twiddle_re;                     // [size / 2] cos(2 pi k / size)
+    double* twiddle_im;                     // [size / 2] sin(2 pi k / size)
+    int* reverse;                           // [size / 2] bit reversed index
+    
+    SpectrumStream streams[SPECTRUM_STREAMS];   // [MAX_NUM_AXES][TOOL_MAX_DUT]
+    
+    CRITICAL_SECTION lock;                  // guards the sums of every stream
+    CWorkerPool Pool;
+    
+    static void Work(void* job);
+    void Periodogram(SpectrumJob* job);
+    
+    // owns the streams and the pool (not copied)
+    CSpectrum(const CSpectrum&);
+    CSpectrum& operator=(const CSpectrum&);
+
+public:
+    CSpectrum(void);
+    ~CSpectrum(void);
+    
+    int Start(int segment);
+    void Stop(void);
+    bool IsStarted(void) const { return (this->size > 0); }
+    
+    void Clear(void);
+    void Add(const int* output, int count, int num_axes, const double* weight);
+    void Density(int axis, double rate, double f_low, double f_high, double* density, word* listDut);
+    
+    // Fourier transform of size real samples (in x): power[size / 2 + 1]
+    // is |X(k)|^2.  re and im are [size / 2] of scratch.
+    void PowerOf(const double* x, double* re, double* im, double* power) const;
+};
+
+#endif
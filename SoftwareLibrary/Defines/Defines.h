@@ -46,12 +46,21 @@ using namespace std;
 #define APP_MAX_COL                     256             // used by Parser
 #define APP_MAX_ARRAY_DIM               4               // for DBGArray
 #define APP_MAX_REG_PRINT               15              // for ToString in RAM
-#define APP_MAX_SAMPLES                 100             // for sense_output
+#define APP_SAMPLE_BLOCK                32              // samples read before decoding
 
 // file i/o directory
 #define FILEIO_READ                     0
 #define FILEIO_WRITE                    1
 
+// checkpoint journal (see CJournal)
+#define JOURNAL_PATH                    ".\\Journal.bin"
+#define JOURNAL_SIZE                    0x100000        // 1 MB
+
+// serial number pool (see CSerialPool), one file shared by every tester
+// on this machine (it has to be made once, see CSerialPool::Open)
+#define SN_POOL_PATH                    "C:\\KionixProductionTest\\Global\\SerialPool.bin"
+#define SN_POOL_NAME                    "SerialPool"    // shared mapping
+
 //-----------------------------------------------------------------------------
 // test flows
 #define PROGRAMMING                     0
@@ -106,6 +115,7 @@ using namespace std;
 #define PAGE_02                         0x02
 #define PAGE_INVALID                    0xFF
 #define ADDR_INVALID                    0xFF
+#define BURN_INVALID                    0xFF            // no OTP burn mode
 
 //-----------------------------------------------------------------------------
 // sense element flags
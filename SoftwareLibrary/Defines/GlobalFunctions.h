@@ -14,6 +14,9 @@
 // variable name to string
 #define STR( t )                #t
 
+// compile-time check: fails to build (negative array size) if expr is false
+#define STATIC_CHECK( expr, msg )   typedef char STATIC_CHECK_##msg[(expr) ? 1 : -1]
+
 //-----------------------------------------------------------------------------
 // device under test and site
 #define _dut                    listDut[d] - 1
@@ -50,6 +50,7 @@
 #define STATE_REDUNDANT_READ_MODE               31
 #define STATE_SINGLE_ENDED_READ_MODE            32
 #define STATE_LOCK_MEMORY_ACCESS                33
+#define STATE_BURN_MODE                         34
 
 #ifdef _NO_FLIP_
     #define STATE_SENS_TRIM_XY_1                41
@@ -19,6 +19,7 @@ PTCBase::PTCBase()
     memset(this->listDut, 0, sizeof(this->listDut));
     this->ASIC = NULL;
     this->Tool = NULL;
+    this->ResumeStep = 0;
 }
 
 /******************************************************************************
@@ -72,6 +73,7 @@ void PTCBase::Init(void)
     this->Init_listDut();
     this->Init_Tool();
     this->Init_ASIC();
+    this->Init_Journal();
 }
 
 /******************************************************************************
@@ -144,6 +146,214 @@ int PTCBase::Init_Generic_Tool(void)
     return SUCCESS;
 }
 
+/******************************************************************************
+    Name:   Init_Journal
+    Desc:   Opens the checkpoint journal.  Whether it can be resumed is only
+            known once the parts can be read (see ResumeJournal).
+******************************************************************************/
+int PTCBase::Init_Journal(void)
+{
+    DBGTrace("-> PTCBase::Init_Journal");
+    
+    this->ResumeStep = 0;
+    
+    if (this->Journal.Open(JOURNAL_PATH, JOURNAL_SIZE) != SUCCESS)
+    {
+        DBGPrint("WARNING: There is no checkpoint journal, so steps can't be resumed.");
+        return ERROR_INIT;
+    }
+    
+    return SUCCESS;
+}
+
+/******************************************************************************
+    Name:   ResumeJournal
+    Desc:   Reads the identity of the parts in the sockets.  If the journal
+            holds steps done on the same parts for the same product and
+            sites, testing resumes after the last one, otherwise the journal
+            is dropped and a new session is started.
+            NOTE: parts must be powered and talking
+******************************************************************************/
+int PTCBase::ResumeJournal(void)
+{
+    DBGTrace("-> PTCBase::ResumeJournal");
+    
+    word sites = this->Sites();
+    byte identity[JOURNAL_MAX_ID];
+    int id_size = this->Identity(identity);
+    const JournalRecord* last = NULL;
+    
+    this->ResumeStep = 0;
+    
+    if (!this->Journal.IsOpen())
+        return ERROR_INIT;
+    
+    if (this->Journal.Matches(sites, (char *) this->PTCInfo.productName, identity, id_size))
+        last = this->Journal.Last();
+    
+    if (last != NULL)
+    {
+        String msg;
+        sprintf(msg, "Resuming after step %i from the checkpoint journal.", last->step);
+        DBGPrint(msg);
+        
+        this->ResumeStep = last->step + 1;
+    }
+    else
+        this->Journal.Begin(sites, (char *) this->PTCInfo.productName, identity, id_size);
+    
+    return SUCCESS;
+}
+
+/******************************************************************************
+    Name:   Identity
+    Desc:   Reads what tells the parts in the sockets apart into
+            identity[JOURNAL_MAX_ID]: the SN of each site in listDut, or for
+            a site with no SN yet a checksum of its ROM.  Returns its size.
+            NOTE: parts with neither (blank OTP) can't be told apart, so they
+            are taken to be the parts the journal was made on
+******************************************************************************/
+int PTCBase::Identity(byte* identity)
+{
+    DBGTrace("-> PTCBase::Identity");
+    
+    String msg;
+    int dut, n;
+    int size = 0;
+    int sn[MAX_SN_SIZE][TOOL_MAX_DUT];
+    byte rom[NUM_ROM_REG][TOOL_MAX_DUT];
+    bool haveROM = false;
+    
+    memset(sn, 0, sizeof(sn));
+    this->ASIC->GetSN(&sn[0][0], this->listDut);
+    
+    for (int d = 0; this->listDut[d] != 0; d++)
+    {
+        dut = this->listDut[d] - 1;
+        n = 0;
+        
+        if (size + MAX_SN_SIZE > JOURNAL_MAX_ID)
+            return 0;
+        
+        for (int b = 0; b < MAX_SN_SIZE; b++)
+        {
+            identity[size + b] = (byte)sn[b][dut];
+            n += (sn[b][dut] != 0);
+        }
+        
+        // no SN yet, so tell it by its ROM (the flag byte keeps it from
+        // looking like an SN)
+        if (n == 0)
+        {
+            if (!haveROM)
+            {
+                memset(rom, 0, sizeof(rom));
+                this->ASIC->GetROM(&rom[0][0], this->listDut);
+                haveROM = true;
+            }
+            
+            byte column[NUM_ROM_REG];
+            for (int r = 0; r < NUM_ROM_REG; r++)
+            {
+                column[r] = rom[r][dut];
+                n += (rom[r][dut] != 0);
+            }
+            
+            dword sum = CJournal::Checksum(column, NUM_ROM_REG);
+            memcpy(&identity[size], &sum, sizeof(sum));
+            identity[size + sizeof(sum)] = 0xFF;
+            
+            if (n == 0)
+            {
+                sprintf(msg, "WARNING: Site %i has no SN and a blank ROM, so the checkpoint journal can't tell it from another blank part.", dut + 1);
+                DBGPrint(msg);
+            }
+        }
+        
+        size += MAX_SN_SIZE;
+    }
+    
+    return size;
+}
+
+/******************************************************************************
+    Name:   Sites
+    Desc:   Returns listDut as a bit mask (bit 0 is DUT 1)
+******************************************************************************/
+word PTCBase::Sites(void)
+{
+    word sites = 0;
+    for (int d = 0; this->listDut[d] != 0; d++)
+        sites |= (1 << (this->listDut[d] - 1));
+    
+    return sites;
+}
+
+/******************************************************************************
+    Name:   Checkpoint
+    Desc:   Records step as done in the journal, with the status of each site,
+            values[num_values][TOOL_MAX_DUT] measured in it and a snapshot of
+            the parts (if any)
+******************************************************************************/
+int PTCBase::Checkpoint(int step, int* status, double* values, int num_values, DeviceSnapshot* snap)
+{
+    DBGTrace("-> PTCBase::Checkpoint");
+    
+    byte data[sizeof(DeviceSnapshot)];
+    int data_size = 0;
+    
+    if (snap != NULL)
+        data_size = snap->Serialize(data, sizeof(data));
+    
+    int result = this->Journal.Append(step, status, values, num_values, data, data_size);
+    
+    if (result == SUCCESS)
+        this->ResumeStep = step + 1;
+    
+    return result;
+}
+
+/******************************************************************************
+    Name:   Restore
+    Desc:   Reads back what Checkpoint recorded for a step done by an earlier
+            run.  Returns false if the journal doesn't have it.
+******************************************************************************/
+bool PTCBase::Restore(int step, int* status, double* values, int num_values, DeviceSnapshot* snap)
+{
+    DBGTrace("-> PTCBase::Restore");
+    
+    const JournalRecord* record = this->Journal.Find(step);
+    if (record == NULL)
+        return false;
+    
+    if (status != NULL)
+        memcpy(status, record->status, sizeof(record->status));
+    
+    if (values != NULL)
+    {
+        int count = min(num_values, record->num_values);
+        memcpy(values, record->Values(), count * TOOL_MAX_DUT * sizeof(double));
+    }
+    
+    if ( (snap != NULL) && (record->data_size > 0) )
+        return snap->Deserialize(record->Data(), record->data_size);
+    
+    return true;
+}
+
+/******************************************************************************
+    Name:   EndJournal
+    Desc:   Every step is done, so the next run starts a new session (one
+            with no identity, which never resumes)
+******************************************************************************/
+void PTCBase::EndJournal(void)
+{
+    DBGTrace("-> PTCBase::EndJournal");
+    
+    this->Journal.Begin(this->Sites(), (char *) this->PTCInfo.productName);
+    this->ResumeStep = 0;
+}
+
 /******************************************************************************
     Name:   DisplayProductToTest
     Desc:   Returns a string to display which product is now being tested
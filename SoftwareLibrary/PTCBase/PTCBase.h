@@ -43,11 +43,25 @@ protected:
     
     PTCInfoStruct PTCInfo;
     
+    // checkpoint journal: each completed step is appended, so a PTC
+    // restarted after a crash skips the steps already done on these sites
+    CJournal Journal;
+    int ResumeStep;                 // steps before this one are done
+    
     void Init(void);
     void CheckSpec(void);
     int Init_listDut(void);
     int Init_Generic_Tool(void);
     int Init_Test(void);
+    int Init_Journal(void);
+    int ResumeJournal(void);
+    
+    word Sites(void);
+    int Identity(byte* identity);
+    bool Completed(int step) { return (step < this->ResumeStep); }
+    int Checkpoint(int step, int* status, double* values = NULL, int num_values = 0, DeviceSnapshot* snap = NULL);
+    bool Restore(int step, int* status, double* values = NULL, int num_values = 0, DeviceSnapshot* snap = NULL);
+    void EndJournal(void);
     
     // redefine in PTC
     virtual int Init_ASIC(void) { return ERROR_INIT; }
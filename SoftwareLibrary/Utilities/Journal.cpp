@@ -0,0 +1,336 @@
+/******************************************************************************
+    
+    File:   Journal.cpp
+    Desc:   Journal is a subclass in Level 1 that keeps an append-only record
+            of test progress in a memory mapped file, so it survives the
+            process dying and can be read back by the next run
+
+******************************************************************************/
+#include "Journal.h"
+
+/******************************************************************************
+    Name:   CJournal
+    Desc:   Default constructor
+******************************************************************************/
+CJournal::CJournal(void)
+{
+    this->file = INVALID_HANDLE_VALUE;
+    this->mapping = NULL;
+    this->view = NULL;
+    this->tail = 0;
+}
+
+/******************************************************************************
+    Name:   ~CJournal
+    Desc:   Default destructor
+******************************************************************************/
+CJournal::~CJournal(void)
+{
+    this->Close();
+}
+
+/******************************************************************************
+    Name:   Open
+    Desc:   Maps the journal file (created, or grown to capacity, if needed).
+            A file that isn't a journal of this capacity is started over.
+******************************************************************************/
+int CJournal::Open(const char* fileName, dword capacity)
+{
+    DBGTrace("---> CJournal::Open");
+    
+    String msg;
+    
+    this->Close();
+    
+    this->file = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (this->file == INVALID_HANDLE_VALUE)
+    {
+        sprintf(msg, "CJournal::Open: could not open %s (%lu)", fileName, GetLastError());
+        CUtilities::Error.Add(msg);
+        return ERROR_INIT;
+    }
+    
+    this->mapping = CreateFileMappingA(this->file, NULL, PAGE_READWRITE, 0, capacity, NULL);
+    if (this->mapping != NULL)
+        this->view = (byte*) MapViewOfFile(this->mapping, FILE_MAP_ALL_ACCESS, 0, 0, capacity);
+    
+    if (this->view == NULL)
+    {
+        sprintf(msg, "CJournal::Open: could not map %s (%lu)", fileName, GetLastError());
+        CUtilities::Error.Add(msg);
+        this->Close();
+        return ERROR_INIT;
+    }
+    
+    JournalHeader* header = this->Header();
+    if ( (header->magic != JOURNAL_MAGIC) || (header->version != JOURNAL_VERSION) ||
+        (header->capacity != capacity) || (header->used > capacity - sizeof(JournalHeader)) )
+    {
+        memset(header, 0, sizeof(JournalHeader));
+        header->magic = JOURNAL_MAGIC;
+        header->version = JOURNAL_VERSION;
+        header->capacity = capacity;
+        this->Flush(header, sizeof(JournalHeader));
+    }
+    
+    // appends go after the last good record (anything after it, like a
+    // record cut off by a crash, is written over)
+    const JournalRecord* last = this->Last();
+    if (last == NULL)
+        this->tail = 0;
+    else
+        this->tail = (dword)((const byte*)last - (this->view + sizeof(JournalHeader))) + last->size;
+    
+    return SUCCESS;
+}
+
+/******************************************************************************
+    Name:   Close
+    Desc:   Unmaps and closes the journal file
+******************************************************************************/
+void CJournal::Close(void)
+{
+    if (this->view != NULL)
+    {
+        FlushViewOfFile(this->view, 0);
+        UnmapViewOfFile(this->view);
+        this->view = NULL;
+    }
+    
+    if (this->mapping != NULL)
+    {
+        CloseHandle(this->mapping);
+        this->mapping = NULL;
+    }
+    
+    if (this->file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(this->file);
+        this->file = INVALID_HANDLE_VALUE;
+    }
+}
+
+/******************************************************************************
+    Name:   Begin
+    Desc:   Starts a new session for sites (a listDut mask) testing name on
+            the parts identity was read from, dropping every record.  A
+            session with no identity never matches (see Matches).
+******************************************************************************/
+void CJournal::Begin(word sites, const char* name, const byte* identity, int id_size)
+{
+    DBGTrace("---> CJournal::Begin");
+    
+    if (!this->IsOpen())
+        return;
+    
+    JournalHeader* header = this->Header();
+    header->used = 0;
+    this->tail = 0;
+    header->sites = sites;
+    memset(header->name, 0, sizeof(header->name));
+    strncpy_s(header->name, sizeof(header->name), name, _TRUNCATE);
+    
+    memset(header->identity, 0, sizeof(header->identity));
+    header->id_size = 0;
+    if ( (identity != NULL) && (id_size > 0) && (id_size <= JOURNAL_MAX_ID) )
+    {
+        memcpy(header->identity, identity, id_size);
+        header->id_size = id_size;
+    }
+    else if (id_size > JOURNAL_MAX_ID)
+        CUtilities::Error.Add("CJournal::Begin: identity too long, the session can't be resumed");
+    
+    this->Flush(header, sizeof(JournalHeader));
+}
+
+/******************************************************************************
+    Name:   Matches
+    Desc:   Returns true if the session in the journal is for the same sites
+            and name, on the same parts (identity read from them, like the
+            SN).  Without an identity nothing matches, since other parts
+            could be in the sockets.
+******************************************************************************/
+bool CJournal::Matches(word sites, const char* name, const byte* identity, int id_size) const
+{
+    if ( !this->IsOpen() || (identity == NULL) || (id_size <= 0) )
+        return false;
+    
+    const JournalHeader* header = this->Header();
+    
+    return ( (header->sites == sites) &&
+        (strncmp(header->name, name, sizeof(header->name) - 1) == 0) &&
+        (header->id_size == (dword)id_size) &&
+        (memcmp(header->identity, identity, id_size) == 0) );
+}
+
+/******************************************************************************
+    Name:   Append
+    Desc:   Adds a record for a completed step: the status of each site,
+            values[num_values][TOOL_MAX_DUT] and data.  The record is flushed
+            to the file before the header is moved past it.
+******************************************************************************/
+int CJournal::Append(int step, int* status, double* values, int num_values, const byte* data, int data_size)
+{
+    DBGTrace("---> CJournal::Append");
+    
+    if (!this->IsOpen())
+        return ERROR_INIT;
+    
+    JournalHeader* header = this->Header();
+    
+    // drop anything after the last good record
+    header->used = this->tail;
+    
+    int value_size = num_values * TOOL_MAX_DUT * sizeof(double);
+    dword size = sizeof(JournalRecord) + value_size + data_size;
+    size = (size + 7) & ~7;
+    
+    if (size > header->capacity - sizeof(JournalHeader) - header->used)
+    {
+        CUtilities::Error.Add("CJournal::Append: journal is full");
+        return ERROR_RUN;
+    }
+    
+    JournalRecord* record = (JournalRecord*)(this->view + sizeof(JournalHeader) + header->used);
+    
+    memset(record, 0, size);
+    record->size = size;
+    record->step = step;
+    record->num_values = num_values;
+    record->data_size = data_size;
+    if (status != NULL)
+        memcpy(record->status, status, sizeof(record->status));
+    if (value_size > 0)
+        memcpy((void*)record->Values(), values, value_size);
+    if (data_size > 0)
+        memcpy((void*)record->Data(), data, data_size);
+    
+    record->checksum = Checksum((byte*)&record->step, size - (2 * sizeof(dword)));
+    this->Flush(record, size);
+    
+    // commit
+    header->used += size;
+    this->tail = header->used;
+    this->Flush(header, sizeof(JournalHeader));
+    
+    return SUCCESS;
+}
+
+/******************************************************************************
+    Name:   Count
+    Desc:   Number of whole records in the journal
+******************************************************************************/
+int CJournal::Count(void) const
+{
+    int count = 0;
+    for (const JournalRecord* record = this->Next(NULL); record != NULL; record = this->Next(record))
+        count++;
+    
+    return count;
+}
+
+/******************************************************************************
+    Name:   Record
+    Desc:   Returns the record at index, or NULL if there isn't a whole one
+******************************************************************************/
+const JournalRecord* CJournal::Record(int index) const
+{
+    const JournalRecord* record = this->Next(NULL);
+    for (int i = 0; (i < index) && (record != NULL); i++)
+        record = this->Next(record);
+    
+    return (index < 0) ? NULL : record;
+}
+
+/******************************************************************************
+    Name:   Find
+    Desc:   Returns the last record for step, or NULL if it isn't there
+******************************************************************************/
+const JournalRecord* CJournal::Find(int step) const
+{
+    const JournalRecord* found = NULL;
+    
+    for (const JournalRecord* record = this->Next(NULL); record != NULL; record = this->Next(record))
+    {
+        if (record->step == step)
+            found = record;
+    }
+    
+    return found;
+}
+
+/******************************************************************************
+    Name:   Last
+    Desc:   Returns the last whole record, or NULL if there are none
+******************************************************************************/
+const JournalRecord* CJournal::Last(void) const
+{
+    const JournalRecord* last = NULL;
+    
+    for (const JournalRecord* record = this->Next(NULL); record != NULL; record = this->Next(record))
+        last = record;
+    
+    return last;
+}
+
+/******************************************************************************
+    Name:   Next
+    Desc:   Returns the record after record (the first one if NULL), or NULL
+            if there isn't a whole one with a good checksum
+******************************************************************************/
+const JournalRecord* CJournal::Next(const JournalRecord* record) const
+{
+    if (!this->IsOpen())
+        return NULL;
+    
+    const JournalHeader* header = this->Header();
+    const byte* start = this->view + sizeof(JournalHeader);
+    dword offset = 0;
+    
+    if (record != NULL)
+        offset = (dword)((const byte*)record - start) + record->size;
+    
+    if (offset + sizeof(JournalRecord) > header->used)
+        return NULL;
+    
+    const JournalRecord* next = (const JournalRecord*)(start + offset);
+    
+    if ( (next->size < sizeof(JournalRecord)) || (next->size > header->used - offset) ||
+        (next->checksum != Checksum((const byte*)&next->step, next->size - (2 * sizeof(dword)))) )
+        return NULL;
+    
+    return next;
+}
+
+/******************************************************************************
+    Name:   Checksum
+    Desc:   Fletcher-32 style checksum of a record (or any other data)
+******************************************************************************/
+dword CJournal::Checksum(const byte* data, int size)
+{
+    dword sum1 = 0xFFFF;
+    dword sum2 = 0xFFFF;
+    
+    for (int i = 0; i < size; i++)
+    {
+        sum1 = (sum1 + data[i]) % 0xFFFF;
+        sum2 = (sum2 + sum1) % 0xFFFF;
+    }
+    
+    return (sum2 << 16) | sum1;
+}
+
+/******************************************************************************
+    Name:   Flush
+    Desc:   Writes part of the view back to the file
+******************************************************************************/
+void CJournal::Flush(const void* start, int size)
+{
+    if (!FlushViewOfFile(start, size))
+    {
+        String msg;
+        sprintf(msg, "CJournal: could not flush the journal (%lu)", GetLastError());
+        CUtilities::Error.Add(msg);
+    }
+}
@@ -0,0 +1,90 @@
+/******************************************************************************
+    
+    File:   Journal.h
+    Desc:   Journal is a subclass in Level 1 that keeps an append-only record
+            of test progress in a memory mapped file, so it survives the
+            process dying and can be read back by the next run
+
+******************************************************************************/
+#ifndef _JOURNAL_H_
+#define _JOURNAL_H_
+
+#include "Defines.h"
+
+#define JOURNAL_MAGIC       0x4C4E524A      // "JRNL"
+#define JOURNAL_VERSION     2
+#define JOURNAL_MAX_NAME    32
+#define JOURNAL_MAX_ID      64              // bytes of device identity
+
+//-----------------------------------------------------------------------------
+//  JournalHeader: start of the journal file.  used is only moved on past a
+//  record once the whole record is written, so a record cut off by a crash
+//  is never read back.
+typedef struct JournalHeader
+{
+    dword magic;
+    dword version;
+    dword capacity;                         // bytes in the file
+    dword used;                             // bytes of records after this
+    word sites;                             // listDut the session is for
+    word reserved;
+    char name[JOURNAL_MAX_NAME];            // what is being tested
+    dword id_size;                          // bytes of identity (0: none)
+    byte identity[JOURNAL_MAX_ID];          // read from the parts (SN, ...)
+    dword spare[2];                         // records start 8 byte aligned
+} JournalHeader;
+
+//-----------------------------------------------------------------------------
+//  JournalRecord: one completed step, followed by
+//  values[num_values][TOOL_MAX_DUT] and then data_size bytes of data
+typedef struct JournalRecord
+{
+    dword size;                             // whole record, padded to 8
+    dword checksum;                         // of everything after this
+    int step;
+    int status[TOOL_MAX_DUT];
+    int num_values;
+    int data_size;
+    int reserved;                           // values start 8 byte aligned
+    
+    const double* Values(void) const { return (const double*)(this + 1); }
+    const byte* Data(void) const { return (const byte*)(Values() + (num_values * TOOL_MAX_DUT)); }
+} JournalRecord;
+
+//-----------------------------------------------------------------------------
+//  Journal class definition
+class CJournal
+{
+private:
+    HANDLE file;
+    HANDLE mapping;
+    byte* view;
+    dword tail;                             // bytes of good records
+    
+    JournalHeader* Header(void) const { return (JournalHeader*)this->view; }
+    const JournalRecord* Next(const JournalRecord* record) const;
+    void Flush(const void* start, int size);
+
+public:
+    CJournal(void);
+    ~CJournal(void);
+    
+    int Open(const char* fileName, dword capacity);
+    void Close(void);
+    bool IsOpen(void) const { return (this->view != NULL); }
+    
+    // start a new session (drops every record)
+    void Begin(word sites, const char* name, const byte* identity = NULL, int id_size = 0);
+    bool Matches(word sites, const char* name, const byte* identity, int id_size) const;
+    
+    int Append(int step, int* status, double* values, int num_values, const byte* data, int data_size);
+    
+    int Count(void) const;
+    const JournalRecord* Record(int index) const;
+    const JournalRecord* Find(int step) const;
+    const JournalRecord* Last(void) const;
+    
+    static dword Checksum(const byte* data, int size);
+};
+
+#endif
@@ -0,0 +1,220 @@
+/******************************************************************************
+    
+    File:   SerialPool.cpp
+    Desc:   SerialPool is a subclass in Level 1 that hands out unique serial
+            numbers from a counter kept in a memory mapped file, shared by
+            every thread and process using the same file
+
+******************************************************************************/
+#include "SerialPool.h"
+
+/******************************************************************************
+    Name:   CSerialPool
+    Desc:   Default constructor
+******************************************************************************/
+CSerialPool::CSerialPool(void)
+{
+    this->file = INVALID_HANDLE_VALUE;
+    this->mapping = NULL;
+    this->lock = NULL;
+    this->pool = NULL;
+    this->counter_bits = 0;
+}
+
+/******************************************************************************
+    Name:   ~CSerialPool
+    Desc:   Default destructor
+******************************************************************************/
+CSerialPool::~CSerialPool(void)
+{
+    this->Close();
+}
+
+/******************************************************************************
+    Name:   Open
+    Desc:   Maps the pool file through the named mapping mapName, so every
+            process sees the same counter.  Only create makes a new pool
+            (starting at 0 with the given prefix), so a pool that went
+            missing is never silently started over and serials reused.  The
+            new pool is set up under a named mutex, with its magic written
+            last, so no one uses it half set up.
+            size is the bytes in a serial: the counter gets the low 32 bits
+            (all of them if there are fewer) and the prefix has to fit in
+            the rest, or the pool isn't opened.
+******************************************************************************/
+int CSerialPool::Open(const char* fileName, const char* mapName, int size, bool create, dword prefix)
+{
+    DBGTrace("---> CSerialPool::Open");
+    
+    String msg;
+    String lockName;
+    int result = SUCCESS;
+    
+    this->Close();
+    
+    if ( (size < 1) || (size > (int)sizeof(qword)) )
+    {
+        sprintf(msg, "CSerialPool::Open: a serial can't be %i bytes", size);
+        CUtilities::Error.Add(msg);
+        return ERROR_INIT;
+    }
+    
+    this->counter_bits = min(32, 8 * size);
+    int prefix_bits = (8 * size) - this->counter_bits;
+    
+    if ( create && (prefix_bits < 32) && ((prefix >> prefix_bits) != 0) )
+    {
+        sprintf(msg, "CSerialPool::Open: the prefix 0x%lX doesn't fit in a %i byte serial", prefix, size);
+        CUtilities::Error.Add(msg);
+        return ERROR_INIT;
+    }
+    
+    this->file = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        NULL, create ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (this->file == INVALID_HANDLE_VALUE)
+    {
+        sprintf(msg, "CSerialPool::Open: could not open %s (%lu)", fileName, GetLastError());
+        CUtilities::Error.Add(msg);
+        return ERROR_INIT;
+    }
+    
+    sprintf(lockName, "%sLock", mapName);
+    this->lock = CreateMutexA(NULL, FALSE, lockName);
+    if (this->lock == NULL)
+    {
+        sprintf(msg, "CSerialPool::Open: could not make the %s mutex (%lu)", (char *) lockName, GetLastError());
+        CUtilities::Error.Add(msg);
+        this->Close();
+        return ERROR_INIT;
+    }
+    
+    this->mapping = CreateFileMappingA(this->file, NULL, PAGE_READWRITE, 0, sizeof(SerialPoolFile), mapName);
+    if (this->mapping != NULL)
+        this->pool = (SerialPoolFile*) MapViewOfFile(this->mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SerialPoolFile));
+    
+    if (this->pool == NULL)
+    {
+        sprintf(msg, "CSerialPool::Open: could not map %s (%lu)", fileName, GetLastError());
+        CUtilities::Error.Add(msg);
+        this->Close();
+        return ERROR_INIT;
+    }
+    
+    WaitForSingleObject(this->lock, INFINITE);
+    
+    // set up a new pool: header first, magic last
+    if ( create && (this->pool->magic == 0) )
+    {
+        this->pool->version = SERIAL_POOL_VERSION;
+        this->pool->prefix = prefix;
+        this->pool->next = 0;
+        FlushViewOfFile(this->pool, sizeof(SerialPoolFile));
+        
+        InterlockedExchange(&this->pool->magic, SERIAL_POOL_MAGIC);
+        FlushViewOfFile(this->pool, sizeof(SerialPoolFile));
+    }
+    
+    if ( (this->pool->magic != SERIAL_POOL_MAGIC) || (this->pool->version != SERIAL_POOL_VERSION) )
+    {
+        sprintf(msg, "CSerialPool::Open: %s is not a serial pool", fileName);
+        CUtilities::Error.Add(msg);
+        result = ERROR_INIT;
+    }
+    // serials have to fit in size bytes
+    else if ( (prefix_bits < 32) && ((this->pool->prefix >> prefix_bits) != 0) )
+    {
+        sprintf(msg, "CSerialPool::Open: the prefix 0x%lX of %s doesn't fit in a %i byte serial",
+            this->pool->prefix, fileName, size);
+        CUtilities::Error.Add(msg);
+        result = ERROR_INIT;
+    }
+    else if ( (this->counter_bits < 32) && (((dword)this->pool->next >> this->counter_bits) != 0) )
+    {
+        sprintf(msg, "CSerialPool::Open: the counter of %s is past a %i byte serial", fileName, size);
+        CUtilities::Error.Add(msg);
+        result = ERROR_INIT;
+    }
+    
+    ReleaseMutex(this->lock);
+    
+    if (result != SUCCESS)
+        this->Close();
+    
+    return result;
+}
+
+/******************************************************************************
+    Name:   Close
+    Desc:   Unmaps and closes the pool file
+******************************************************************************/
+void CSerialPool::Close(void)
+{
+    if (this->pool != NULL)
+    {
+        FlushViewOfFile(this->pool, sizeof(SerialPoolFile));
+        UnmapViewOfFile(this->pool);
+        this->pool = NULL;
+    }
+    
+    if (this->mapping != NULL)
+    {
+        CloseHandle(this->mapping);
+        this->mapping = NULL;
+    }
+    
+    if (this->lock != NULL)
+    {
+        CloseHandle(this->lock);
+        this->lock = NULL;
+    }
+    
+    if (this->file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(this->file);
+        this->file = INVALID_HANDLE_VALUE;
+    }
+}
+
+/******************************************************************************
+    Name:   Reserve
+    Desc:   Reserves count consecutive serials, returning the first.  The
+            block is taken from the shared counter with an interlocked
+            compare-exchange (no lock), so no two callers (threads or
+            processes) ever get the same serial.
+******************************************************************************/
+int CSerialPool::Reserve(int count, qword* first)
+{
+    DBGTrace("---> CSerialPool::Reserve");
+    
+    if (!this->IsOpen())
+        return ERROR_INIT;
+    
+    if (count <= 0)
+    {
+        CUtilities::Error.Add("CSerialPool::Reserve: at least one serial has to be reserved");
+        return ERROR_RUN;
+    }
+    
+    dword start;
+    qword end = (qword)1 << this->counter_bits;
+    
+    // take the block with a compare-exchange, and never past the end
+    do
+    {
+        start = (dword) this->pool->next;
+        
+        if ((qword)start + count > end)
+        {
+            CUtilities::Error.Add("CSerialPool::Reserve: the serial pool is used up");
+            return ERROR_RUN;
+        }
+    }
+    while ((dword) InterlockedCompareExchange(&this->pool->next, (LONG)(start + count), (LONG)start) != start);
+    
+    // keep it even if the process dies
+    FlushViewOfFile(this->pool, sizeof(SerialPoolFile));
+    
+    *first = ((qword)this->pool->prefix << this->counter_bits) | start;
+    
+    return SUCCESS;
+}
@@ -0,0 +1,51 @@
+/******************************************************************************
+    
+    File:   SerialPool.h
+    Desc:   SerialPool is a subclass in Level 1 that hands out unique serial
+            numbers from a counter kept in a memory mapped file, shared by
+            every thread and process using the same file
+
+******************************************************************************/
+#ifndef _SERIAL_POOL_H_
+#define _SERIAL_POOL_H_
+
+#include "Defines.h"
+
+#define SERIAL_POOL_MAGIC   0x4C504E53      // "SNPL"
+#define SERIAL_POOL_VERSION 1
+
+//-----------------------------------------------------------------------------
+//  SerialPoolFile: contents of the pool file.  Serials are a counter in the
+//  low bits (up to 32 of them) and prefix in the bits above, in as many
+//  bytes as the serial number register has (see CSerialPool::Open).
+typedef struct SerialPoolFile
+{
+    volatile LONG magic;
+    dword version;
+    dword prefix;                           // high bits of every serial
+    volatile LONG next;                     // next free counter value
+} SerialPoolFile;
+
+//-----------------------------------------------------------------------------
+//  SerialPool class definition
+class CSerialPool
+{
+private:
+    HANDLE file;
+    HANDLE mapping;
+    HANDLE lock;                            // named mutex for setting up
+    SerialPoolFile* pool;
+    int counter_bits;                       // low bits of a serial counted
+
+public:
+    CSerialPool(void);
+    ~CSerialPool(void);
+    
+    int Open(const char* fileName, const char* mapName, int size, bool create = false, dword prefix = 0);
+    void Close(void);
+    bool IsOpen(void) const { return (this->pool != NULL); }
+    
+    int Reserve(int count, qword* first);
+};
+
+#endif
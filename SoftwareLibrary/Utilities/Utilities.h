@@ -16,6 +16,9 @@
 #include "Message.h"
 #include "Error.h"
 #include "FileIO.h"
+#include "Journal.h"
+#include "SerialPool.h"
+#include "WorkerPool.h"
 
 //-----------------------------------------------------------------------------
 //  Utilities class definition
@@ -0,0 +1,193 @@
+/******************************************************************************
+    
+    File:   WorkerPool.cpp
+    Desc:   WorkerPool is a subclass in Level 1 that runs jobs on a few
+            worker threads, so long calculations go on while the caller
+            keeps talking to the parts
+
+******************************************************************************/
+#include "WorkerPool.h"
+
+/******************************************************************************
+    Name:   CWorkerPool
+    Desc:   Default constructor
+******************************************************************************/
+CWorkerPool::CWorkerPool(void)
+{
+    this->num_threads = 0;
+    this->queued = NULL;
+    this->space = NULL;
+    this->idle = NULL;
+    this->head = 0;
+    this->count = 0;
+    this->busy = 0;
+    this->stopping = false;
+    
+    InitializeCriticalSection(&this->lock);
+}
+
+/******************************************************************************
+    Name:   ~CWorkerPool
+    Desc:   Default destructor
+******************************************************************************/
+CWorkerPool::~CWorkerPool(void)
+{
+    this->Stop();
+    
+    DeleteCriticalSection(&this->lock);
+}
+
+/******************************************************************************
+    Name:   Start
+    Desc:   Starts num_threads worker threads (up to WORKER_MAX_THREADS).
+            Until the pool is started, Submit runs each job right away on
+            the calling thread.
+******************************************************************************/
+int CWorkerPool::Start(int num_threads)
+{
+    DBGTrace("---> CWorkerPool::Start");
+    
+    this->Stop();
+    
+    num_threads = max(1, min(num_threads, WORKER_MAX_THREADS));
+    
+    this->queued = CreateSemaphoreA(NULL, 0, WORKER_MAX_JOBS, NULL);
+    this->space = CreateSemaphoreA(NULL, WORKER_MAX_JOBS, WORKER_MAX_JOBS, NULL);
+    this->idle = CreateEventA(NULL, TRUE, TRUE, NULL);
+    if ( (this->queued == NULL) || (this->space == NULL) || (this->idle == NULL) )
+    {
+        CUtilities::Error.Add("CWorkerPool::Start: could not create the queue");
+        this->Stop();
+        return ERROR_INIT;
+    }
+    
+    this->head = 0;
+    this->count = 0;
+    this->busy = 0;
+    this->stopping = false;
+    
+    for (int t = 0; t < num_threads; t++)
+    {
+        this->threads[t] = (HANDLE) _beginthreadex(NULL, 0, CWorkerPool::Run, this, 0, NULL);
+        if (this->threads[t] == NULL)
+        {
+            CUtilities::Error.Add("CWorkerPool::Start: could not start a worker thread");
+            this->Stop();
+            return ERROR_INIT;
+        }
+        this->num_threads++;
+    }
+    
+    return SUCCESS;
+}
+
+/******************************************************************************
+    Name:   Stop
+    Desc:   Waits for every job, then ends the worker threads
+******************************************************************************/
+void CWorkerPool::Stop(void)
+{
+    DBGTrace("---> CWorkerPool::Stop");
+    
+    if (this->num_threads > 0)
+    {
+        this->Wait();
+        
+        // wake every thread with nothing queued so it sees it should stop
+        EnterCriticalSection(&this->lock);
+        this->stopping = true;
+        LeaveCriticalSection(&this->lock);
+        ReleaseSemaphore(this->queued, this->num_threads, NULL);
+        
+        for (int t = 0; t < this->num_threads; t++)
+        {
+            WaitForSingleObject(this->threads[t], INFINITE);
+            CloseHandle(this->threads[t]);
+        }
+        this->num_threads = 0;
+    }
+    
+    if (this->queued != NULL)
+        CloseHandle(this->queued);
+    if (this->space != NULL)
+        CloseHandle(this->space);
+    if (this->idle != NULL)
+        CloseHandle(this->idle);
+    
+    this->queued = NULL;
+    this->space = NULL;
+    this->idle = NULL;
+}
+
+/******************************************************************************
+    Name:   Submit
+    Desc:   Queues job(arg) for the next free worker (waiting for room in the
+            queue if it is full).  The job owns arg from then on.
+******************************************************************************/
+void CWorkerPool::Submit(WorkerJob job, void* arg)
+{
+    if (this->num_threads == 0)
+    {
+        job(arg);
+        return;
+    }
+    
+    WaitForSingleObject(this->space, INFINITE);
+    
+    EnterCriticalSection(&this->lock);
+    this->queue[(this->head + this->count) % WORKER_MAX_JOBS].job = job;
+    this->queue[(this->head + this->count) % WORKER_MAX_JOBS].arg = arg;
+    this->count++;
+    this->busy++;
+    ResetEvent(this->idle);
+    LeaveCriticalSection(&this->lock);
+    
+    ReleaseSemaphore(this->queued, 1, NULL);
+}
+
+/******************************************************************************
+    Name:   Wait
+    Desc:   Waits until every submitted job has finished
+******************************************************************************/
+void CWorkerPool::Wait(void)
+{
+    if (this->num_threads > 0)
+        WaitForSingleObject(this->idle, INFINITE);
+}
+
+/******************************************************************************
+    Name:   Run
+    Desc:   Worker thread: runs queued tasks until the pool stops
+******************************************************************************/
+unsigned __stdcall CWorkerPool::Run(void* pool)
+{
+    CWorkerPool* self = (CWorkerPool*) pool;
+    WorkerTask task;
+    
+    for (;;)
+    {
+        WaitForSingleObject(self->queued, INFINITE);
+        
+        EnterCriticalSection(&self->lock);
+        if ( (self->count == 0) && self->stopping )
+        {
+            LeaveCriticalSection(&self->lock);
+            break;
+        }
+        task = self->queue[self->head];
+        self->head = (self->head + 1) % WORKER_MAX_JOBS;
+        self->count--;
+        LeaveCriticalSection(&self->lock);
+        
+        ReleaseSemaphore(self->space, 1, NULL);
+        
+        task.job(task.arg);
+        
+        EnterCriticalSection(&self->lock);
+        if (--self->busy == 0)
+            SetEvent(self->idle);
+        LeaveCriticalSection(&self->lock);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,62 @@
+/******************************************************************************
+    
+    File:   WorkerPool.h
+    Desc:   WorkerPool is a subclass in Level 1 that runs jobs on a few
+            worker threads, so long calculations go on while the caller
+            keeps talking to the parts
+
+******************************************************************************/
+#ifndef _WORKER_POOL_H_
+#define _WORKER_POOL_H_
+
+#include "Defines.h"
+
+#define WORKER_MAX_THREADS  8
+#define WORKER_MAX_JOBS     64              // queued jobs before Submit waits
+
+// a job is a function and what to call it with
+typedef void (*WorkerJob)(void* arg);
+
+typedef struct WorkerTask
+{
+    WorkerJob job;
+    void* arg;
+} WorkerTask;
+
+//-----------------------------------------------------------------------------
+//  WorkerPool class definition
+class CWorkerPool
+{
+private:
+    HANDLE threads[WORKER_MAX_THREADS];
+    int num_threads;
+    
+    CRITICAL_SECTION lock;                  // guards everything below
+    HANDLE queued;                          // semaphore: tasks in the queue
+    HANDLE space;                           // semaphore: free queue slots
+    HANDLE idle;                            // event: no task queued or running
+    WorkerTask queue[WORKER_MAX_JOBS];
+    int head;
+    int count;                              // tasks in the queue
+    int busy;                               // tasks queued or running
+    bool stopping;
+    
+    static unsigned __stdcall Run(void* pool);
+    
+    // owns the threads (not copied)
+    CWorkerPool(const CWorkerPool&);
+    CWorkerPool& operator=(const CWorkerPool&);
+
+public:
+    CWorkerPool(void);
+    ~CWorkerPool(void);
+    
+    int Start(int num_threads);
+    void Stop(void);
+    bool IsStarted(void) const { return (this->num_threads > 0); }
+    
+    void Submit(WorkerJob job, void* arg);
+    void Wait(void);
+};
+
+#endif